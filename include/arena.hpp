@@ -0,0 +1,268 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Bump allocator for data that only lives until the end of the frame (draw
+// lists, culling results, sort keys, formatted names). Allocation is a pointer
+// bump, freeing is a no-op and reset() drops everything at once. When a frame
+// needs more than one block, reset() replaces the blocks with a single one
+// of the combined size, so the steady state is one block and no heap traffic.
+class FrameArena
+{
+  public:
+    explicit FrameArena(size_t blockSize = 1 << 20) : blockSize(blockSize) {}
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    ~FrameArena()
+    {
+        for (size_t i = 0; i < blocks.size(); ++i)
+            std::free(blocks[i].data);
+    }
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        if (!blocks.empty())
+        {
+            uintptr_t base = (uintptr_t)blocks.back().data;
+            size_t start =
+                ((base + offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+            if (start + size <= blocks.back().size)
+            {
+                usedBytes += start + size - offset;
+                offset = start + size;
+                return blocks.back().data + start;
+            }
+        }
+        // the current block is full: carry on in a new one
+        Block block;
+        block.size = size + align > blockSize ? size + align : blockSize;
+        block.data = (char*)std::malloc(block.size);
+        if (!block.data)
+        {
+            std::cout << "ERROR::ARENA::OUT_OF_MEMORY: " << block.size
+                      << std::endl;
+            return NULL;
+        }
+        blocks.push_back(block);
+        offset = 0;
+        return allocate(size, align);
+    }
+
+    template <typename T> T* allocateArray(size_t count)
+    {
+        return (T*)allocate(count * sizeof(T), alignof(T));
+    }
+
+    // NUL-terminated copy that stays valid until reset()
+    const char* copy(const char* text, size_t length)
+    {
+        char* out = (char*)allocate(length + 1, 1);
+        if (out)
+        {
+            std::memcpy(out, text, length);
+            out[length] = '\0';
+        }
+        return out;
+    }
+    const char* copy(const std::string& text)
+    {
+        return copy(text.data(), text.size());
+    }
+
+    void reset()
+    {
+        if (usedBytes > peakBytes)
+            peakBytes = usedBytes;
+        if (blocks.size() > 1)
+        {
+            size_t total = 0;
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                total += blocks[i].size;
+                std::free(blocks[i].data);
+            }
+            blocks.clear();
+            Block block;
+            block.size = total;
+            block.data = (char*)std::malloc(total);
+            if (block.data)
+                blocks.push_back(block);
+            ++growCount;
+        }
+        offset = 0;
+        usedBytes = 0;
+    }
+
+    size_t used() const { return usedBytes; }
+    // most bytes used in a single frame, including the current one
+    size_t highWater() const
+    {
+        return usedBytes > peakBytes ? usedBytes : peakBytes;
+    }
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < blocks.size(); ++i)
+            total += blocks[i].size;
+        return total;
+    }
+    // frames that outgrew the arena and made reset() reallocate
+    unsigned long grows() const { return growCount; }
+
+  private:
+    struct Block
+    {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t offset = 0;
+    size_t usedBytes = 0, peakBytes = 0;
+    unsigned long growCount = 0;
+};
+
+// STL allocator over a FrameArena, e.g.
+//   std::vector<DrawItem, ArenaAllocator<DrawItem>> items(frameArena());
+// deallocate() does nothing; the memory comes back with the next reset().
+template <typename T> class ArenaAllocator
+{
+  public:
+    typedef T value_type;
+
+    ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena)
+    {
+    }
+
+    T* allocate(size_t count) { return arena->allocateArray<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U> bool operator==(const ArenaAllocator<U>& other) const
+    {
+        return arena == other.arena;
+    }
+    template <typename U> bool operator!=(const ArenaAllocator<U>& other) const
+    {
+        return arena != other.arena;
+    }
+
+    FrameArena* arena;
+};
+
+// One arena per thread, created on first use. The main loop calls endFrame()
+// once every thread is done with the frame's data; that only moves the frame
+// counter on, and each arena is reset by its own thread the first time it is
+// used in the new frame. So no thread ever touches another thread's arena,
+// and data stays valid at least until the end of the frame it was made in.
+//
+// Threads that do not work in step with the frames (the simulation thread)
+// must not use these; they keep a FrameArena of their own and reset it at
+// their own boundary, e.g. once per tick.
+class FrameArenas
+{
+  public:
+    static FrameArenas& instance()
+    {
+        static FrameArenas arenas;
+        return arenas;
+    }
+
+    ~FrameArenas()
+    {
+        for (size_t i = 0; i < arenas.size(); ++i)
+            delete arenas[i];
+    }
+
+    FrameArena& local()
+    {
+        thread_local Holder holder;
+        unsigned long current = frames.load(std::memory_order_acquire);
+        if (!holder.arena)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!spare.empty())
+            {
+                holder.arena = spare.back();
+                spare.pop_back();
+            }
+            else
+            {
+                holder.arena = new FrameArena();
+                arenas.push_back(holder.arena);
+            }
+        }
+        else if (holder.frame != current)
+            holder.arena->reset();
+        holder.frame = current;
+        return *holder.arena;
+    }
+
+    void endFrame() { frames.fetch_add(1, std::memory_order_release); }
+
+    // counts endFrame() calls; memory from local() is good while it is the
+    // same as when the memory was allocated
+    unsigned long frame() const
+    {
+        return frames.load(std::memory_order_acquire);
+    }
+
+    // reads every thread's arena, so only while the others are idle (exit)
+    void print(std::ostream& out)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t peak = 0, capacity = 0;
+        unsigned long grows = 0;
+        for (size_t i = 0; i < arenas.size(); ++i)
+        {
+            peak += arenas[i]->highWater();
+            capacity += arenas[i]->capacity();
+            grows += arenas[i]->grows();
+        }
+        if (peak == 0)
+            return;
+        out << "frame arenas: " << arenas.size() << " thread(s), high water "
+            << peak / 1024.0 << " KB of " << capacity / 1024.0 << " KB, "
+            << grows << " grow(s)" << std::endl;
+    }
+
+  private:
+    // hands the arena back for reuse when its thread exits
+    struct Holder
+    {
+        FrameArena* arena = NULL;
+        unsigned long frame = 0; // when the arena was last reset
+        ~Holder()
+        {
+            if (arena)
+                FrameArenas::instance().release(arena);
+        }
+    };
+
+    std::atomic<unsigned long> frames{0};
+    std::mutex mutex;
+    std::vector<FrameArena*> arenas;
+    std::vector<FrameArena*> spare;
+
+    void release(FrameArena* arena)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        arena->reset();
+        spare.push_back(arena);
+    }
+};
+
+inline FrameArena& frameArena() { return FrameArenas::instance().local(); }
+
+#endif
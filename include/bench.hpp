@@ -0,0 +1,285 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Micro-benchmark runner for CPU-only code paths (no GL context).
+//
+//   BENCH(terrain_generate)
+//   {
+//       Map map;                      // setup, not timed
+//       while (state.keepRunning())   // timed
+//           map.generate(100, 100);
+//   }
+//
+// Each benchmark is first calibrated so one repetition lasts at least
+// `minTime`, then warmed up and repeated; the report gives per-iteration
+// min / median / mean / stddev over the repetitions.
+namespace bench
+{
+
+typedef std::chrono::steady_clock Clock;
+
+class State
+{
+  public:
+    explicit State(size_t iterations) : iterations(iterations), left(0) {}
+
+    // true while the body should run again; the first call starts the clock
+    bool keepRunning()
+    {
+        if (!started)
+        {
+            started = true;
+            left = iterations;
+            start = Clock::now();
+        }
+        if (left > 0)
+        {
+            --left;
+            return true;
+        }
+        stop = Clock::now();
+        return false;
+    }
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(stop - start).count();
+    }
+
+    // items processed per iteration, reported as a rate
+    void setItems(size_t items) { itemsPerIteration = items; }
+
+    size_t iterations;
+    size_t itemsPerIteration = 0;
+
+  private:
+    size_t left;
+    bool started = false;
+    Clock::time_point start, stop;
+};
+
+// keeps the compiler from dropping a computation whose result is unused
+template <typename T> inline void keep(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+typedef std::function<void(State&)> Function;
+
+struct Entry
+{
+    std::string name;
+    Function function;
+};
+
+inline std::vector<Entry>& registry()
+{
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+// BENCH covers the usual case; a Register with a lambda adds parameterized
+// variants (e.g. one per thread count)
+struct Register
+{
+    Register(const std::string& name, Function function)
+    {
+        Entry entry = {name, function};
+        registry().push_back(entry);
+    }
+};
+
+#define BENCH(name)                                                            \
+    static void bench_##name(bench::State& state);                             \
+    static bench::Register bench_register_##name(#name, bench_##name);         \
+    static void bench_##name(bench::State& state)
+
+struct Options
+{
+    std::string filter; // substring of the name, empty runs everything
+    double minTime = 0.05; // seconds per repetition
+    int repetitions = 10;
+    int warmup = 2;
+    std::string csvPath;
+    bool list = false;
+};
+
+struct Result
+{
+    std::string name;
+    size_t iterations = 0;
+    double minNs = 0, medianNs = 0, meanNs = 0, stddevNs = 0;
+    double itemsPerSecond = 0;
+};
+
+// runs `function` once with `iterations` and returns ns per iteration
+inline double measure(const Function& function, size_t iterations,
+                      size_t* items)
+{
+    State state(iterations);
+    function(state);
+    if (items)
+        *items = state.itemsPerIteration;
+    return state.seconds() * 1e9 / iterations;
+}
+
+inline Result run(const Entry& entry, const Options& options)
+{
+    // grow the iteration count until one repetition takes minTime
+    size_t iterations = 1;
+    for (;;)
+    {
+        double ns = measure(entry.function, iterations, NULL);
+        double total = ns * iterations * 1e-9;
+        if (total >= options.minTime || iterations >= (1u << 30))
+            break;
+        double scale = total > 0 ? options.minTime / total * 1.2 : 10.0;
+        scale = std::min(std::max(scale, 1.5), 10.0);
+        iterations = (size_t)(iterations * scale) + 1;
+    }
+
+    for (int i = 0; i < options.warmup; ++i)
+        measure(entry.function, iterations, NULL);
+
+    std::vector<double> samples;
+    size_t items = 0;
+    for (int i = 0; i < options.repetitions; ++i)
+        samples.push_back(measure(entry.function, iterations, &items));
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.name = entry.name;
+    result.iterations = iterations;
+    result.minNs = samples.front();
+    size_t n = samples.size();
+    result.medianNs = n % 2 ? samples[n / 2]
+                            : (samples[n / 2 - 1] + samples[n / 2]) / 2.0;
+    double sum = 0.0, squares = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        sum += samples[i];
+    result.meanNs = sum / n;
+    for (size_t i = 0; i < n; ++i)
+        squares += (samples[i] - result.meanNs) * (samples[i] - result.meanNs);
+    result.stddevNs = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+    if (items && result.medianNs > 0)
+        result.itemsPerSecond = items * 1e9 / result.medianNs;
+    return result;
+}
+
+// prints a duration in ns with a unit that keeps it readable
+inline std::string formatNs(double ns)
+{
+    char text[32];
+    if (ns < 1e3)
+        std::snprintf(text, sizeof(text), "%.1f ns", ns);
+    else if (ns < 1e6)
+        std::snprintf(text, sizeof(text), "%.2f us", ns / 1e3);
+    else
+        std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+    return text;
+}
+
+inline bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue)
+            options.filter = argv[++i];
+        else if (arg == "--min-time" && hasValue)
+            options.minTime = std::atof(argv[++i]);
+        else if (arg == "--reps" && hasValue)
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--csv" && hasValue)
+            options.csvPath = argv[++i];
+        else if (arg == "--list")
+            options.list = true;
+        else
+        {
+            std::cout << "usage: " << argv[0]
+                      << " [--filter TEXT] [--min-time SECONDS] [--reps N]"
+                         " [--warmup N] [--csv FILE] [--list]"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// runs every registered benchmark that matches the filter; returns the exit
+// code for main()
+inline int runAll(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+
+    std::vector<Entry> selected;
+    for (size_t i = 0; i < registry().size(); ++i)
+        if (options.filter.empty() ||
+            registry()[i].name.find(options.filter) != std::string::npos)
+            selected.push_back(registry()[i]);
+    if (options.list)
+    {
+        for (size_t i = 0; i < selected.size(); ++i)
+            std::cout << selected[i].name << std::endl;
+        return 0;
+    }
+    if (selected.empty())
+    {
+        std::cout << "ERROR::BENCH::NO_MATCH: " << options.filter << std::endl;
+        return 2;
+    }
+
+    std::ofstream csv;
+    if (!options.csvPath.empty())
+    {
+        csv.open(options.csvPath.c_str());
+        if (!csv)
+        {
+            std::cout << "ERROR::BENCH::CANNOT_WRITE: " << options.csvPath
+                      << std::endl;
+            return 2;
+        }
+        csv << "name,iterations,min_ns,median_ns,mean_ns,stddev_ns,"
+               "items_per_s\n";
+    }
+
+    std::printf("%-28s %10s %12s %12s %8s %14s\n", "benchmark", "iters",
+                "min", "median", "cv", "items/s");
+    for (size_t i = 0; i < selected.size(); ++i)
+    {
+        Result r = run(selected[i], options);
+        double cv = r.meanNs > 0 ? r.stddevNs / r.meanNs * 100.0 : 0.0;
+        char rate[32] = "-";
+        if (r.itemsPerSecond > 0)
+            std::snprintf(rate, sizeof(rate), "%.3g", r.itemsPerSecond);
+        std::printf("%-28s %10zu %12s %12s %7.1f%% %14s\n", r.name.c_str(),
+                    r.iterations, formatNs(r.minNs).c_str(),
+                    formatNs(r.medianNs).c_str(), cv, rate);
+        std::fflush(stdout);
+        if (csv)
+            csv << r.name << ',' << r.iterations << ',' << r.minNs << ','
+                << r.medianNs << ',' << r.meanNs << ',' << r.stddevNs << ','
+                << r.itemsPerSecond << '\n';
+    }
+    return 0;
+}
+
+} // namespace bench
+
+#endif
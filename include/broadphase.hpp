@@ -0,0 +1,298 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "entities.hpp"
+#include "profiler.hpp"
+
+struct Aabb
+{
+    glm::vec3 lo = glm::vec3(0.0f), hi = glm::vec3(0.0f);
+};
+
+// boxes touching on a face count as overlapping
+inline bool overlaps(const Aabb& a, const Aabb& b)
+{
+    return a.lo.x <= b.hi.x && b.lo.x <= a.hi.x && a.lo.y <= b.hi.y &&
+           b.lo.y <= a.hi.y && a.lo.z <= b.hi.z && b.lo.z <= a.hi.z;
+}
+
+// a candidate pair for the narrow phase, each pair reported once in either
+// order
+struct EntityPair
+{
+    Entity a, b;
+};
+
+// Incremental sweep and prune along x. Every box has a min and a max endpoint
+// in one sorted list; update() re-sorts it with an insertion sort, which is
+// close to linear when things moved a little since the last update (the
+// usual case from tick to tick), then sweeps it once: a min endpoint is
+// tested against every box whose interval is open at that point, on y and z.
+// When the insertion sort has to shift too much (a teleport, the first
+// update) it gives up and std::sort()s instead.
+//
+// Proxies keep their id until removed; ids are reused.
+class SweepAndPrune
+{
+  public:
+    typedef uint32_t Proxy;
+
+    Proxy add(Entity entity, const Aabb& box)
+    {
+        Proxy proxy;
+        if (!freeProxies.empty())
+        {
+            proxy = freeProxies.back();
+            freeProxies.pop_back();
+            boxes[proxy] = box;
+            owners[proxy] = entity;
+        }
+        else
+        {
+            proxy = (Proxy)boxes.size();
+            boxes.push_back(box);
+            owners.push_back(entity);
+        }
+        // put in order by the next update
+        Endpoint lo = {box.lo.x, proxy << 1}, hi = {box.hi.x, proxy << 1 | 1};
+        endpoints.push_back(lo);
+        endpoints.push_back(hi);
+        return proxy;
+    }
+
+    void move(Proxy proxy, const Aabb& box) { boxes[proxy] = box; }
+
+    // one pass over the endpoints; meant for the odd despawn, not for
+    // everything every tick
+    void remove(Proxy proxy)
+    {
+        size_t out = 0;
+        for (size_t i = 0; i < endpoints.size(); ++i)
+            if (endpoints[i].id >> 1 != proxy)
+                endpoints[out++] = endpoints[i];
+        endpoints.resize(out);
+        owners[proxy] = NO_ENTITY;
+        freeProxies.push_back(proxy);
+    }
+
+    size_t size() const { return endpoints.size() / 2; }
+    const Aabb& box(Proxy proxy) const { return boxes[proxy]; }
+
+    // how many places the last update's insertion sort shifted endpoints by,
+    // and whether it fell back to a full sort
+    size_t lastShifts() const { return shifts; }
+    bool lastFullSort() const { return fullSort; }
+
+    // every overlapping pair, replacing what `pairs` held
+    void update(std::vector<EntityPair>& pairs)
+    {
+        PROFILE_SCOPE("SweepAndPrune::update");
+        for (size_t i = 0; i < endpoints.size(); ++i)
+        {
+            const Aabb& box = boxes[endpoints[i].id >> 1];
+            endpoints[i].value = endpoints[i].id & 1 ? box.hi.x : box.lo.x;
+        }
+        sort();
+
+        pairs.clear();
+        active.clear();
+        activeRanges.clear();
+        activeSlot.resize(boxes.size());
+        for (size_t i = 0; i < endpoints.size(); ++i)
+        {
+            Proxy proxy = endpoints[i].id >> 1;
+            if (endpoints[i].id & 1)
+            {
+                // closes: the last open interval takes its slot
+                uint32_t slot = activeSlot[proxy];
+                active[slot] = active.back();
+                activeRanges[slot] = activeRanges.back();
+                activeSlot[active[slot]] = slot;
+                active.pop_back();
+                activeRanges.pop_back();
+                continue;
+            }
+            // opens: every open interval overlaps it on x already. The tests
+            // go without branches, whether one z test passes being a coin
+            // flip, and the hits are written out after
+            const Aabb& box = boxes[proxy];
+            const size_t open = active.size();
+            if (hits.size() < open)
+                hits.resize(2 * open);
+            size_t n = 0;
+            for (size_t j = 0; j < open; ++j)
+            {
+                const glm::vec4& r = activeRanges[j]; // lo.y hi.y lo.z hi.z
+                hits[n] = (uint32_t)j;
+                n += (box.lo.y <= r.y) & (r.x <= box.hi.y) &
+                     (box.lo.z <= r.w) & (r.z <= box.hi.z);
+            }
+            for (size_t k = 0; k < n; ++k)
+            {
+                EntityPair pair = {owners[active[hits[k]]], owners[proxy]};
+                pairs.push_back(pair);
+            }
+            activeSlot[proxy] = (uint32_t)active.size();
+            active.push_back(proxy);
+            activeRanges.push_back(
+                glm::vec4(box.lo.y, box.hi.y, box.lo.z, box.hi.z));
+        }
+    }
+
+  private:
+    struct Endpoint
+    {
+        float value;
+        uint32_t id; // proxy << 1, | 1 for the max
+    };
+
+    // a min before a max at the same value, so touching boxes overlap
+    static bool before(const Endpoint& a, const Endpoint& b)
+    {
+        return a.value < b.value ||
+               (a.value == b.value && (a.id & 1) < (b.id & 1));
+    }
+
+    void sort()
+    {
+        const size_t budget = endpoints.size() * 4;
+        shifts = 0;
+        fullSort = false;
+        for (size_t i = 1; i < endpoints.size(); ++i)
+        {
+            Endpoint e = endpoints[i];
+            size_t j = i;
+            for (; j > 0 && before(e, endpoints[j - 1]); --j)
+                endpoints[j] = endpoints[j - 1];
+            endpoints[j] = e;
+            shifts += i - j;
+            if (shifts > budget)
+            {
+                std::sort(endpoints.begin(), endpoints.end(), before);
+                fullSort = true;
+                return;
+            }
+        }
+    }
+
+    std::vector<Aabb> boxes; // by proxy
+    std::vector<Entity> owners;
+    std::vector<Proxy> freeProxies;
+    std::vector<Endpoint> endpoints;
+    size_t shifts = 0;
+    bool fullSort = false;
+
+    // the sweep's open intervals, with their y and z ranges packed alongside
+    // so the inner loop reads one array
+    std::vector<Proxy> active;
+    std::vector<glm::vec4> activeRanges;
+    std::vector<uint32_t> activeSlot; // by proxy
+    std::vector<uint32_t> hits;       // slots in `active`
+};
+
+// Uniform hash grid on x and z with the same interface, rebuilt from scratch
+// on every update: each box goes into every cell it covers, and a pair is
+// only reported from the cell holding the larger of the two min corners, so
+// boxes sharing several cells still come out once. Cells should be at least
+// as wide as most boxes.
+class GridBroadphase
+{
+  public:
+    typedef uint32_t Proxy;
+
+    explicit GridBroadphase(float cellSize = 1.0f) : cellSize(cellSize) {}
+
+    Proxy add(Entity entity, const Aabb& box)
+    {
+        Proxy proxy;
+        if (!freeProxies.empty())
+        {
+            proxy = freeProxies.back();
+            freeProxies.pop_back();
+            boxes[proxy] = box;
+            owners[proxy] = entity;
+        }
+        else
+        {
+            proxy = (Proxy)boxes.size();
+            boxes.push_back(box);
+            owners.push_back(entity);
+        }
+        ++living;
+        return proxy;
+    }
+
+    void move(Proxy proxy, const Aabb& box) { boxes[proxy] = box; }
+
+    void remove(Proxy proxy)
+    {
+        owners[proxy] = NO_ENTITY;
+        freeProxies.push_back(proxy);
+        --living;
+    }
+
+    size_t size() const { return living; }
+    const Aabb& box(Proxy proxy) const { return boxes[proxy]; }
+
+    void update(std::vector<EntityPair>& pairs)
+    {
+        PROFILE_SCOPE("GridBroadphase::update");
+        // keep the buckets' storage, unless most of them went unused
+        if (cells.size() > 4 * living + 64)
+            cells.clear();
+        for (auto& cell : cells)
+            cell.second.clear();
+        for (Proxy proxy = 0; proxy < (Proxy)boxes.size(); ++proxy)
+        {
+            if (owners[proxy] == NO_ENTITY)
+                continue;
+            const Aabb& box = boxes[proxy];
+            int x1 = cellOf(box.hi.x), z1 = cellOf(box.hi.z);
+            for (int x = cellOf(box.lo.x); x <= x1; ++x)
+                for (int z = cellOf(box.lo.z); z <= z1; ++z)
+                    cells[key(x, z)].push_back(proxy);
+        }
+
+        pairs.clear();
+        for (const auto& cell : cells)
+        {
+            const std::vector<Proxy>& bucket = cell.second;
+            for (size_t i = 0; i < bucket.size(); ++i)
+                for (size_t j = i + 1; j < bucket.size(); ++j)
+                {
+                    const Aabb& a = boxes[bucket[i]];
+                    const Aabb& b = boxes[bucket[j]];
+                    if (!overlaps(a, b) ||
+                        key(cellOf(std::max(a.lo.x, b.lo.x)),
+                            cellOf(std::max(a.lo.z, b.lo.z))) != cell.first)
+                        continue;
+                    EntityPair pair = {owners[bucket[i]], owners[bucket[j]]};
+                    pairs.push_back(pair);
+                }
+        }
+    }
+
+  private:
+    int cellOf(float p) const { return (int)std::floor(p / cellSize); }
+    static uint64_t key(int x, int z)
+    {
+        return (uint64_t)(uint32_t)x << 32 | (uint32_t)z;
+    }
+
+    float cellSize;
+    std::vector<Aabb> boxes;
+    std::vector<Entity> owners; // NO_ENTITY for a free proxy
+    std::vector<Proxy> freeProxies;
+    size_t living = 0;
+    std::unordered_map<uint64_t, std::vector<Proxy>> cells;
+};
+
+#endif
@@ -122,6 +122,15 @@ class Camera
         updateCameraVectors();
     }
 
+    // points the camera along the given Euler angles (degrees), e.g. for
+    // scripted camera paths
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires
     // input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
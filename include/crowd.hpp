@@ -0,0 +1,205 @@
+#ifndef CROWD_H
+#define CROWD_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "entities.hpp"
+#include "frustum.hpp"
+#include "jobs.hpp"
+#include "map.hpp"
+#include "profiler.hpp"
+#include "spatial_hash.hpp"
+#include "stream_buffer.hpp"
+
+struct Collider
+{
+    float halfWidth = 0.3f;
+    float height = 3.2f;
+    float stepHeight = 1.0f; // higher ledges turn the walker around
+};
+
+struct RenderMesh
+{
+    unsigned int mesh = 0; // only the person box so far
+    float tint = 0.0f;     // 0..1, blends between two colours in the shader
+};
+
+// NPC "persons" as entities: one packed array per component, and systems that
+// walk those arrays in slot order, split over the job system. Position is the
+// middle of the feet, as for Body.
+class Crowd
+{
+  public:
+    EntityPool entities;
+    Components<glm::vec3> positions;
+    Components<glm::vec3> velocities;
+    Components<Collider> colliders;
+    Components<RenderMesh> meshes;
+
+    Entity spawn(const glm::vec3& position, const glm::vec3& velocity)
+    {
+        indexed = false;
+        Entity entity = entities.create();
+        positions.add(entity, position);
+        velocities.add(entity, velocity);
+        colliders.add(entity, Collider());
+        RenderMesh mesh;
+        mesh.tint = (entityIndex(entity) * 2654435761u >> 16) / 65536.0f;
+        meshes.add(entity, mesh);
+        return entity;
+    }
+
+    void remove(Entity entity)
+    {
+        indexed = false;
+        positions.remove(entity);
+        velocities.remove(entity);
+        colliders.remove(entity);
+        meshes.remove(entity);
+        entities.destroy(entity);
+    }
+
+    // `count` walkers spread over the map, standing on the ground, each
+    // heading its own way at walking pace
+    void populate(const Map& map, size_t count, float speed = 2.0f)
+    {
+        positions.reserve(positions.size() + count);
+        velocities.reserve(velocities.size() + count);
+        colliders.reserve(colliders.size() + count);
+        meshes.reserve(meshes.size() + count);
+        unsigned int seed = 0x2545f491u;
+        for (size_t i = 0; i < count; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int x = (int)(seed >> 8) % map.width;
+            seed = seed * 1664525u + 1013904223u;
+            int z = (int)(seed >> 8) % map.depth;
+            float angle = i * 2.39996f; // golden angle, evenly spread
+            glm::vec3 position((float)x, map.solidTop(x, z), (float)z);
+            glm::vec3 velocity(std::cos(angle), 0.0f, std::sin(angle));
+            spawn(position, velocity * speed);
+        }
+    }
+
+    // movement system: walk, follow the ground, and turn back from walls,
+    // ledges higher than stepHeight and the edge of the map
+    void update(const Map& map, float dt, JobSystem& jobs = jobSystem())
+    {
+        PROFILE_SCOPE("Crowd::update");
+        auto walk = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                Entity entity = positions.entity(i);
+                size_t v = velocities.find(entity, i);
+                size_t c = colliders.find(entity, i);
+                if (v == Components<glm::vec3>::NONE ||
+                    c == Components<Collider>::NONE)
+                    continue;
+                glm::vec3& position = positions[i];
+                glm::vec3& velocity = velocities[v];
+                const Collider& collider = colliders[c];
+                glm::vec3 next = position + velocity * dt;
+                // probe the ground just ahead of the leading side
+                glm::vec3 ahead = next;
+                ahead.x += velocity.x > 0.0f ? collider.halfWidth
+                                             : -collider.halfWidth;
+                ahead.z += velocity.z > 0.0f ? collider.halfWidth
+                                             : -collider.halfWidth;
+                float top = map.solidTop(Map::cellOf(ahead.x),
+                                         Map::cellOf(ahead.z));
+                if (top > position.y + collider.stepHeight)
+                {
+                    velocity = -velocity;
+                    continue;
+                }
+                next.y =
+                    map.solidTop(Map::cellOf(next.x), Map::cellOf(next.z));
+                position = next;
+            }
+        };
+        jobs.parallelFor(positions.size(), 4096, walk);
+        indexed = false;
+    }
+
+    // walkers at most `radius` from `center`, e.g. what the player can reach
+    // or an NPC can see. The first query after anything moved rebuilds the
+    // spatial hash.
+    size_t nearby(const glm::vec3& center, float radius,
+                  std::vector<Entity>& out)
+    {
+        if (!indexed)
+        {
+            grid.build(positions.entityData(), positions.data(),
+                       positions.size());
+            indexed = true;
+        }
+        return grid.queryRadius(center, radius, out);
+    }
+
+    // per drawn entity: feet position and tint, as the crowd shader reads it
+    void gatherInstances(std::vector<glm::vec4>& out) const
+    {
+        out.resize(meshes.size());
+        size_t n = 0;
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            size_t p = positions.find(meshes.entity(i), i);
+            if (p != Components<glm::vec3>::NONE)
+                out[n++] = glm::vec4(positions[p], meshes[i].tint);
+        }
+        out.resize(n);
+    }
+
+  private:
+    SpatialHash grid;
+    bool indexed = false;
+};
+
+// Draws every instance the frustum does not reject with one instanced call.
+// The visible instances are written into this frame's region of `stream`,
+// which attribute 3 (vec4, one per instance) of `vao` then points at.
+// Returns the number of instances drawn.
+inline unsigned int drawCrowd(const std::vector<glm::vec4>& instances,
+                              const glm::mat4& viewProjection,
+                              StreamBuffer& stream, unsigned int vao,
+                              const Collider& size = Collider())
+{
+    PROFILE_SCOPE("drawCrowd");
+    if (instances.empty())
+        return 0;
+    stream.beginFrame();
+    StreamBuffer::Allocation a =
+        stream.allocate(instances.size() * sizeof(glm::vec4));
+    unsigned int drawn = 0;
+    if (a.valid())
+    {
+        const Frustum frustum(viewProjection);
+        glm::vec4* out = (glm::vec4*)a.ptr;
+        glm::vec3 extent(size.halfWidth, size.height, size.halfWidth);
+        for (size_t i = 0; i < instances.size(); ++i)
+        {
+            glm::vec3 feet(instances[i]);
+            if (frustum.intersects(feet - glm::vec3(extent.x, 0.0f, extent.z),
+                                   feet + extent))
+                out[drawn++] = instances[i];
+        }
+    }
+    stream.finishWrites();
+    if (drawn)
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.ID);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+                              (void*)a.offset);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, drawn);
+    }
+    stream.endFrame();
+    return drawn;
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Entity ids: the low 24 bits index the slot, the high 8 bits count how often
+// the slot was reused, so a stale id never matches the entity that took its
+// place.
+typedef uint32_t Entity;
+const Entity NO_ENTITY = 0xffffffffu;
+
+inline uint32_t entityIndex(Entity entity) { return entity & 0xffffffu; }
+
+class EntityPool
+{
+  public:
+    Entity create()
+    {
+        uint32_t index;
+        if (!freeSlots.empty())
+        {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            index = (uint32_t)generations.size();
+            generations.push_back(0);
+        }
+        ++living;
+        return index | (uint32_t)generations[index] << 24;
+    }
+
+    void destroy(Entity entity)
+    {
+        if (!alive(entity))
+            return;
+        uint32_t index = entityIndex(entity);
+        ++generations[index];
+        freeSlots.push_back(index);
+        --living;
+    }
+
+    bool alive(Entity entity) const
+    {
+        uint32_t index = entityIndex(entity);
+        return entity != NO_ENTITY && index < generations.size() &&
+               generations[index] == entity >> 24;
+    }
+
+    size_t count() const { return living; }
+
+  private:
+    std::vector<uint8_t> generations;
+    std::vector<uint32_t> freeSlots;
+    size_t living = 0;
+};
+
+// Sparse-set storage for one component type. The values sit packed in one
+// array, so a system walks them in order with no gaps; `sparse` maps an
+// entity to its slot in that array. Removing swaps the last value into the
+// hole, so the packed order is the order of insertion until something is
+// removed.
+template <typename T> class Components
+{
+  public:
+    static const size_t NONE = (size_t)-1;
+
+    T& add(Entity entity, const T& value = T())
+    {
+        uint32_t index = entityIndex(entity);
+        if (index >= sparse.size())
+            sparse.resize(index + 1, 0);
+        if (sparse[index] != 0 && owners[sparse[index] - 1] == entity)
+            return values[sparse[index] - 1] = value;
+        owners.push_back(entity);
+        values.push_back(value);
+        sparse[index] = (uint32_t)owners.size();
+        return values.back();
+    }
+
+    void remove(Entity entity)
+    {
+        size_t slot = indexOf(entity);
+        if (slot == NONE)
+            return;
+        size_t last = owners.size() - 1;
+        owners[slot] = owners[last];
+        values[slot] = values[last];
+        sparse[entityIndex(owners[slot])] = (uint32_t)slot + 1;
+        sparse[entityIndex(entity)] = 0;
+        owners.pop_back();
+        values.pop_back();
+    }
+
+    // packed slot of `entity`, NONE if it has no such component
+    size_t indexOf(Entity entity) const
+    {
+        uint32_t index = entityIndex(entity);
+        if (index >= sparse.size() || sparse[index] == 0 ||
+            owners[sparse[index] - 1] != entity)
+            return NONE;
+        return sparse[index] - 1;
+    }
+
+    // indexOf(), trying `hint` first: components added to several stores in
+    // the same order sit at the same slot in each, and that needs no lookup
+    size_t find(Entity entity, size_t hint) const
+    {
+        if (hint < owners.size() && owners[hint] == entity)
+            return hint;
+        return indexOf(entity);
+    }
+
+    bool has(Entity entity) const { return indexOf(entity) != NONE; }
+    T& get(Entity entity) { return values[indexOf(entity)]; }
+    const T& get(Entity entity) const { return values[indexOf(entity)]; }
+
+    size_t size() const { return owners.size(); }
+    void reserve(size_t count)
+    {
+        owners.reserve(count);
+        values.reserve(count);
+    }
+    Entity entity(size_t slot) const { return owners[slot]; }
+    T& operator[](size_t slot) { return values[slot]; }
+    const T& operator[](size_t slot) const { return values[slot]; }
+    // the packed arrays, slot order
+    const T* data() const { return values.data(); }
+    const Entity* entityData() const { return owners.data(); }
+
+  private:
+    std::vector<uint32_t> sparse; // entity index -> slot + 1, 0 for none
+    std::vector<Entity> owners;
+    std::vector<T> values;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef FLYTHROUGH_H
+#define FLYTHROUGH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "camera.hpp"
+#include "frame_stats.hpp"
+
+// One control point of a camera path. Yaw is not wrapped, so a path can turn
+// several times around by just increasing it.
+struct CameraKey
+{
+    float time; // seconds from the start of the path
+    glm::vec3 position;
+    float yaw, pitch;
+};
+
+// Camera path through the scene, interpolated with a Catmull-Rom spline so
+// the motion has no kinks at the keys. A benchmark renders it in `frames`
+// steps regardless of how long the frames take.
+class CameraPath
+{
+  public:
+    std::string name;
+    int frames = 0;
+    std::vector<CameraKey> keys;
+
+    CameraPath() {}
+    CameraPath(const std::string& name, int frames) : name(name), frames(frames)
+    {
+    }
+
+    void key(float time, glm::vec3 position, float yaw, float pitch)
+    {
+        CameraKey k = {time, position, yaw, pitch};
+        keys.push_back(k);
+    }
+
+    float duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+    CameraKey sample(float time) const
+    {
+        if (keys.size() < 2 || time <= keys.front().time)
+            return keys.front();
+        if (time >= keys.back().time)
+            return keys.back();
+
+        unsigned int i = 0;
+        while (keys[i + 1].time < time)
+            ++i;
+        const CameraKey& k0 = keys[i > 0 ? i - 1 : i];
+        const CameraKey& k1 = keys[i];
+        const CameraKey& k2 = keys[i + 1];
+        const CameraKey& k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+        float u = (time - k1.time) / (k2.time - k1.time);
+
+        CameraKey out;
+        out.time = time;
+        out.position =
+            catmullRom(k0.position, k1.position, k2.position, k3.position, u);
+        out.yaw = catmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, u);
+        out.pitch = catmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, u);
+        return out;
+    }
+
+    // pose for frame `frame` of `frames`
+    CameraKey sampleFrame(int frame) const
+    {
+        if (frames <= 1)
+            return sample(0.0f);
+        return sample(duration() * frame / (frames - 1));
+    }
+
+  private:
+    template <typename T>
+    static T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3,
+                       float u)
+    {
+        float u2 = u * u, u3 = u2 * u;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * u +
+                       (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+                       (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+    }
+};
+
+// The built-in scenes, laid out for a `width` x `depth` terrain whose blocks
+// are at most about 11 units high
+inline std::vector<CameraPath> benchmarkScenes(int width, int depth)
+{
+    std::vector<CameraPath> scenes;
+    float w = (float)width, d = (float)depth;
+    glm::vec3 center(w * 0.5f, 0.0f, d * 0.5f);
+
+    // low, fast pass diagonally over the terrain, most of it in view
+    CameraPath low("low_pass", 600);
+    low.key(0.0f, glm::vec3(0.05f * w, 15.0f, 0.05f * d), 45.0f, -15.0f);
+    low.key(3.0f, glm::vec3(0.35f * w, 14.0f, 0.25f * d), 35.0f, -12.0f);
+    low.key(6.0f, glm::vec3(0.55f * w, 16.0f, 0.55f * d), 55.0f, -18.0f);
+    low.key(10.0f, glm::vec3(0.95f * w, 15.0f, 0.95f * d), 45.0f, -15.0f);
+    scenes.push_back(low);
+
+    // high orbit looking down at the map; the far plane (100) still clips
+    // the far corners
+    CameraPath overview("overview", 600);
+    const int steps = 8;
+    for (int i = 0; i <= steps; ++i)
+    {
+        float angle = 360.0f * i / steps;
+        glm::vec3 offset(cos(glm::radians(angle)), 0.0f,
+                         sin(glm::radians(angle)));
+        // looking back at the center: yaw points along -offset
+        overview.key(10.0f * i / steps,
+                     center + offset * (0.3f * w) + glm::vec3(0, 40.0f, 0),
+                     angle + 180.0f, -45.0f);
+    }
+    scenes.push_back(overview);
+
+    // fast turns on the spot: the visible set changes completely every
+    // few frames
+    CameraPath spin("spin", 600);
+    for (int i = 0; i <= 10; ++i)
+        spin.key(1.0f * i, center + glm::vec3(0, 16.0f, 0), 144.0f * i,
+                 i % 2 ? -30.0f : 5.0f);
+    scenes.push_back(spin);
+    return scenes;
+}
+
+// Runs the selected scenes one after another and collects per-scene frame
+// times and draw counts. The first `warmup` frames of each scene are rendered
+// but not measured.
+class FlythroughBenchmark
+{
+  public:
+    struct Result
+    {
+        std::string name;
+        FrameTimings timings;
+        unsigned long long draws = 0; // summed over the measured frames
+        unsigned long long triangles = 0;
+    };
+
+    int warmup = 30;
+
+    // `which` is a scene name or "all"
+    bool select(const std::vector<CameraPath>& scenes, const std::string& which)
+    {
+        paths.clear();
+        for (unsigned int i = 0; i < scenes.size(); ++i)
+            if (which == "all" || which == scenes[i].name)
+                paths.push_back(scenes[i]);
+        if (paths.empty())
+        {
+            std::cout << "ERROR::BENCHMARK::UNKNOWN_SCENE: " << which
+                      << std::endl;
+            return false;
+        }
+        results.clear();
+        results.resize(paths.size());
+        for (unsigned int i = 0; i < paths.size(); ++i)
+            results[i].name = paths[i].name;
+        scene = 0;
+        frame = -warmup;
+        lastTime = -1.0;
+        return true;
+    }
+
+    bool active() const { return scene < paths.size(); }
+
+    // puts the camera where the current frame of the current scene is
+    void apply(Camera& camera) const
+    {
+        CameraKey pose = paths[scene].sampleFrame(frame < 0 ? 0 : frame);
+        camera.Position = pose.position;
+        camera.SetOrientation(pose.yaw, pose.pitch);
+    }
+
+    // call once per frame, at the same point of every frame, with the time
+    void endFrame(double time, const DrawCounts& counts)
+    {
+        if (!active())
+            return;
+        Result& result = results[scene];
+        if (frame >= 0 && lastTime >= 0.0)
+        {
+            result.timings.add((time - lastTime) * 1000.0);
+            result.draws += counts.draws;
+            result.triangles += counts.triangles;
+        }
+        lastTime = time;
+        if (++frame == paths[scene].frames)
+        {
+            result.timings.print(std::cout, result.name.c_str());
+            ++scene;
+            frame = -warmup;
+        }
+    }
+
+    void writeJson(std::ostream& out, const std::string& renderer, int width,
+                   int height) const
+    {
+        char line[512];
+        out << "{\n";
+        out << "  \"renderer\": \"" << escape(renderer) << "\",\n";
+        out << "  \"width\": " << width << ",\n";
+        out << "  \"height\": " << height << ",\n";
+        out << "  \"scenes\": [\n";
+        for (unsigned int i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            double frames = r.timings.count() ? (double)r.timings.count() : 1.0;
+            std::snprintf(line, sizeof(line),
+                          "    {\"name\": \"%s\", \"frames\": %zu, "
+                          "\"avg_ms\": %.4f, \"p50_ms\": %.4f, "
+                          "\"p95_ms\": %.4f, \"p99_ms\": %.4f, "
+                          "\"max_ms\": %.4f, \"draw_calls\": %.0f, "
+                          "\"triangles\": %.0f}%s\n",
+                          escape(r.name).c_str(), r.timings.count(),
+                          r.timings.average(), r.timings.percentile(50),
+                          r.timings.percentile(95), r.timings.percentile(99),
+                          r.timings.max(), r.draws / frames,
+                          r.triangles / frames,
+                          i + 1 < results.size() ? "," : "");
+            out << line;
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+  private:
+    std::vector<CameraPath> paths;
+    std::vector<Result> results;
+    unsigned int scene = 0;
+    int frame = 0;
+    double lastTime = -1.0;
+
+    static std::string escape(const std::string& s)
+    {
+        std::string out;
+        for (unsigned int i = 0; i < s.size(); ++i)
+        {
+            if (s[i] == '"' || s[i] == '\\')
+                out += '\\';
+            if ((unsigned char)s[i] >= 0x20)
+                out += s[i];
+        }
+        return out;
+    }
+};
+
+#endif
@@ -0,0 +1,405 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "png_writer.hpp"
+
+// Captures frames without stalling the pipeline: glReadPixels goes into one of
+// a few pixel buffer objects and is only mapped `latency` frames later, just
+// before its buffer is read into again, when the GPU has long finished the
+// copy. The mapped pixels are handed to a worker thread that writes a PNG
+// (screenshots) or appends raw RGB frames to a file (sequences, e.g.
+// `ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i out.raw`).
+class FrameCapture
+{
+  public:
+    struct Stats
+    {
+        unsigned long captured = 0; // frames read back and handed over
+        unsigned long stalls = 0;   // readbacks the GPU was not done with
+        unsigned long written = 0;  // frames written by the worker
+        unsigned long failed = 0;   // frames the worker could not write
+    };
+
+    FrameCapture() {}
+    ~FrameCapture() { stopWorker(); }
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // needs the GL context; `latency` is the number of frames between the read
+    // and the map, and also the number of PBOs
+    void init(int width, int height, int latency = 3)
+    {
+        shutdown();
+        this->width = width;
+        this->height = height;
+        slots.resize(latency);
+        for (unsigned int i = 0; i < slots.size(); ++i)
+        {
+            glGenBuffers(1, &slots[i].pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes(), NULL,
+                         GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        startWorker();
+    }
+
+    // the framebuffer changed size: what is in flight is written at the old
+    // size, then the buffers are made again. A raw sequence has one size, so
+    // it ends here; a requested screenshot is kept.
+    void resize(int width, int height)
+    {
+        if (slots.empty() || width <= 0 || height <= 0 ||
+            (width == this->width && height == this->height))
+            return;
+        std::string screenshot = screenshotPath;
+        init(width, height, (int)slots.size());
+        screenshotPath = screenshot;
+    }
+
+    // releases the PBOs and waits for the worker; call before the context
+    // goes away
+    void shutdown()
+    {
+        if (slots.empty())
+            return;
+        flush();
+        stopSequence();
+        for (unsigned int i = 0; i < slots.size(); ++i)
+        {
+            if (slots[i].fence)
+                glDeleteSync(slots[i].fence);
+            glDeleteBuffers(1, &slots[i].pbo);
+        }
+        slots.clear();
+        stopWorker();
+    }
+
+    // the next captured frame is written to `path` as PNG
+    void requestScreenshot(const std::string& path)
+    {
+        screenshotPath = path;
+    }
+
+    // every captured frame is appended to `path` until stopSequence()
+    void startSequence(const std::string& path)
+    {
+        stopSequence();
+        sequencePath = path;
+        Job job;
+        job.kind = JOB_OPEN_SEQUENCE;
+        job.path = path;
+        push(job);
+    }
+
+    void stopSequence()
+    {
+        if (sequencePath.empty())
+            return;
+        // frames still in flight belong to the sequence
+        collect(true);
+        Job job;
+        job.kind = JOB_CLOSE_SEQUENCE;
+        push(job);
+        std::cout << "capture: " << sequencePath << " is raw rgb24 " << width
+                  << "x" << height << std::endl;
+        sequencePath.clear();
+    }
+
+    bool active() const
+    {
+        return !screenshotPath.empty() || !sequencePath.empty();
+    }
+
+    // call once per frame after rendering and before the swap. `framebuffer`
+    // is 0 for the window's back buffer, or an FBO for offscreen rendering
+    void capture(GLuint framebuffer = 0)
+    {
+        if (slots.empty())
+            return;
+        ++frame;
+        collect(false);
+        if (!active())
+            return;
+
+        Slot& slot = slots[frame % slots.size()];
+        if (slot.fence)
+            retrieve(slot, true);
+
+        GLint previousRead = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+        if (!screenshotPath.empty())
+        {
+            slot.kind = JOB_PNG;
+            slot.path = screenshotPath;
+            screenshotPath.clear();
+        }
+        else
+        {
+            slot.kind = JOB_RAW;
+            slot.path.clear();
+        }
+    }
+
+    // blocks until every pending readback reached the worker and the worker
+    // wrote it out
+    void flush()
+    {
+        collect(true);
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return jobs.empty() && !busy; });
+    }
+
+    Stats getStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+  private:
+    enum JobKind
+    {
+        JOB_PNG,
+        JOB_RAW,
+        JOB_OPEN_SEQUENCE,
+        JOB_CLOSE_SEQUENCE
+    };
+
+    struct Slot
+    {
+        unsigned int pbo = 0;
+        GLsync fence = 0;
+        unsigned long frame = 0;
+        JobKind kind = JOB_RAW;
+        std::string path;
+    };
+
+    struct Job
+    {
+        JobKind kind;
+        std::string path;
+        int width = 0, height = 0;
+        std::vector<unsigned char> pixels; // RGBA, bottom row first
+    };
+
+    int width = 0, height = 0;
+    unsigned long frame = 0;
+    std::vector<Slot> slots;
+    std::string screenshotPath;
+    std::string sequencePath;
+    Stats stats;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    std::deque<Job> jobs;
+    bool busy = false;
+    bool quit = false;
+    FILE* sequence = NULL;
+
+    size_t frameBytes() const { return (size_t)width * height * 4; }
+
+    // hands over every readback that is old enough (or all of them), oldest
+    // first so a sequence stays in order; frame f went to slot f % size
+    void collect(bool all)
+    {
+        for (unsigned int i = 1; i <= slots.size(); ++i)
+        {
+            Slot& slot = slots[(frame + i) % slots.size()];
+            if (!slot.fence)
+                continue;
+            if (all || frame - slot.frame >= slots.size())
+                retrieve(slot, all);
+        }
+    }
+
+    void retrieve(Slot& slot, bool block)
+    {
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            if (!block)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++stats.stalls;
+            }
+            glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                             GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+
+        Job job;
+        job.kind = slot.kind;
+        job.path = slot.path;
+        job.width = width;
+        job.height = height;
+        job.pixels.resize(frameBytes());
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes(),
+                                      GL_MAP_READ_BIT);
+        if (data)
+        {
+            std::copy((unsigned char*)data, (unsigned char*)data + frameBytes(),
+                      job.pixels.begin());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!data)
+        {
+            std::cout << "ERROR::FRAME_CAPTURE::MAP_FAILED" << std::endl;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.captured;
+        }
+        push(job);
+    }
+
+    void push(Job& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(Job());
+            jobs.back().kind = job.kind;
+            jobs.back().path.swap(job.path);
+            jobs.back().width = job.width;
+            jobs.back().height = job.height;
+            jobs.back().pixels.swap(job.pixels);
+        }
+        wake.notify_one();
+    }
+
+    void startWorker()
+    {
+        quit = false;
+        worker = std::thread(&FrameCapture::workerLoop, this);
+    }
+
+    void stopWorker()
+    {
+        if (!worker.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            if (jobs.empty())
+            {
+                if (quit)
+                    break;
+                wake.wait(lock);
+                continue;
+            }
+            Job job;
+            job.kind = jobs.front().kind;
+            job.path.swap(jobs.front().path);
+            job.width = jobs.front().width;
+            job.height = jobs.front().height;
+            job.pixels.swap(jobs.front().pixels);
+            jobs.pop_front();
+            busy = true;
+            lock.unlock();
+            process(job);
+            lock.lock();
+            busy = false;
+            if (jobs.empty())
+                idle.notify_all();
+        }
+        if (sequence)
+            std::fclose(sequence);
+        sequence = NULL;
+    }
+
+    // worker thread only
+    void process(Job& job)
+    {
+        switch (job.kind)
+        {
+        case JOB_OPEN_SEQUENCE:
+            if (sequence)
+                std::fclose(sequence);
+            sequence = std::fopen(job.path.c_str(), "wb");
+            if (!sequence)
+                std::cout << "ERROR::FRAME_CAPTURE::OPEN_FAILED: " << job.path
+                          << std::endl;
+            return;
+        case JOB_CLOSE_SEQUENCE:
+            if (sequence)
+                std::fclose(sequence);
+            sequence = NULL;
+            return;
+        default:
+            break;
+        }
+
+        // GL rows start at the bottom; drop alpha and flip while packing
+        const int w = job.width, h = job.height;
+        std::vector<unsigned char> rgb((size_t)w * h * 3);
+        for (int y = 0; y < h; ++y)
+        {
+            const unsigned char* src = &job.pixels[(size_t)y * w * 4];
+            unsigned char* dst = &rgb[(size_t)(h - 1 - y) * w * 3];
+            for (int x = 0; x < w; ++x)
+            {
+                dst[x * 3 + 0] = src[x * 4 + 0];
+                dst[x * 3 + 1] = src[x * 4 + 1];
+                dst[x * 3 + 2] = src[x * 4 + 2];
+            }
+        }
+
+        bool ok;
+        if (job.kind == JOB_PNG)
+        {
+            ok = png::write(job.path.c_str(), w, h, 3, &rgb[0]);
+            if (ok)
+                std::cout << "capture: wrote " << job.path << std::endl;
+            else
+                std::cout << "ERROR::FRAME_CAPTURE::WRITE_FAILED: "
+                          << job.path << std::endl;
+        }
+        else
+        {
+            // no file when opening the sequence failed
+            ok = sequence && std::fwrite(&rgb[0], 1, rgb.size(), sequence) ==
+                                 rgb.size();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ++(ok ? stats.written : stats.failed);
+    }
+};
+
+#endif
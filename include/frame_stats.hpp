@@ -0,0 +1,76 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// Draw calls and triangles submitted for one frame
+struct DrawCounts
+{
+    unsigned long draws = 0;
+    unsigned long triangles = 0;
+
+    void add(unsigned long drawCalls, unsigned long trianglesEach)
+    {
+        draws += drawCalls;
+        triangles += drawCalls * trianglesEach;
+    }
+};
+
+// Frame times of a benchmark run and the usual summary numbers
+class FrameTimings
+{
+  public:
+    std::vector<double> ms;
+
+    void add(double frameMs) { ms.push_back(frameMs); }
+    void clear() { ms.clear(); }
+    size_t count() const { return ms.size(); }
+
+    double average() const
+    {
+        if (ms.empty())
+            return 0.0;
+        double sum = 0.0;
+        for (unsigned int i = 0; i < ms.size(); ++i)
+            sum += ms[i];
+        return sum / ms.size();
+    }
+
+    // nearest-rank percentile, p in [0, 100]
+    double percentile(double p) const
+    {
+        if (ms.empty())
+            return 0.0;
+        std::vector<double> sorted(ms);
+        std::sort(sorted.begin(), sorted.end());
+        size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    double min() const
+    {
+        return ms.empty() ? 0.0 : *std::min_element(ms.begin(), ms.end());
+    }
+    double max() const
+    {
+        return ms.empty() ? 0.0 : *std::max_element(ms.begin(), ms.end());
+    }
+
+    void print(std::ostream& out, const char* label) const
+    {
+        char line[200];
+        double avg = average();
+        std::snprintf(line, sizeof(line),
+                      "%s: %zu frames, avg %.3f ms (%.1f fps), min %.3f, "
+                      "p50 %.3f, p95 %.3f, p99 %.3f, max %.3f ms",
+                      label, ms.size(), avg, avg > 0.0 ? 1000.0 / avg : 0.0,
+                      min(), percentile(50), percentile(95), percentile(99),
+                      max());
+        out << line << std::endl;
+    }
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// The six clip planes of a view-projection matrix, for culling boxes on the
+// CPU before they are drawn.
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& viewProjection)
+    {
+        // Gribb/Hartmann: the planes are sums and differences of the rows
+        glm::mat4 m = glm::transpose(viewProjection);
+        planes[0] = m[3] + m[0];
+        planes[1] = m[3] - m[0];
+        planes[2] = m[3] + m[1];
+        planes[3] = m[3] - m[1];
+        planes[4] = m[3] + m[2];
+        planes[5] = m[3] - m[2];
+    }
+
+    // false only when the box is entirely outside one of the planes
+    bool intersects(const glm::vec3& lo, const glm::vec3& hi) const
+    {
+        for (int p = 0; p < 6; ++p)
+        {
+            // the box corner furthest along the plane normal
+            glm::vec3 corner(planes[p].x > 0 ? hi.x : lo.x,
+                             planes[p].y > 0 ? hi.y : lo.y,
+                             planes[p].z > 0 ? hi.z : lo.z);
+            if (glm::dot(glm::vec3(planes[p]), corner) + planes[p].w < 0)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// The generated glad loader only covers core GL 4.0 without extensions, so the
+// few newer entry points we can take advantage of are resolved here with the
+// same loader function after gladLoadGLLoader succeeded.
+
+// KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// ARB_buffer_storage (core in 4.4)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size,
+                                               const void* data,
+                                               GLbitfield flags);
+
+struct GLExtensions
+{
+    bool parallelShaderCompile = false;
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreadsKHR = NULL;
+    bool bufferStorage = false;
+    PFNGLBUFFERSTORAGEPROC BufferStorage = NULL;
+    // ARB_timer_query (core in 3.3); the entry points are in glad already
+    bool timerQuery = false;
+};
+
+inline GLExtensions& glExtensions()
+{
+    static GLExtensions extensions;
+    return extensions;
+}
+
+inline bool hasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && std::strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// call once the context is current and glad is loaded
+inline void loadGLExtensions(GLADloadproc load)
+{
+    GLExtensions& ext = glExtensions();
+    ext = GLExtensions();
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile") ||
+        hasGLExtension("GL_ARB_parallel_shader_compile"))
+    {
+        ext.MaxShaderCompilerThreadsKHR =
+            (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load(
+                "glMaxShaderCompilerThreadsKHR");
+        if (!ext.MaxShaderCompilerThreadsKHR)
+            ext.MaxShaderCompilerThreadsKHR =
+                (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load(
+                    "glMaxShaderCompilerThreadsARB");
+        ext.parallelShaderCompile = true;
+        // let the driver pick as many compiler threads as it likes
+        if (ext.MaxShaderCompilerThreadsKHR)
+            ext.MaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    }
+
+    bool core44 =
+        GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4);
+    if (core44 || hasGLExtension("GL_ARB_buffer_storage"))
+    {
+        ext.BufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+        ext.bufferStorage = ext.BufferStorage != NULL;
+    }
+
+    bool core33 =
+        GLVersion.major > 3 || (GLVersion.major == 3 && GLVersion.minor >= 3);
+    if ((core33 || hasGLExtension("GL_ARB_timer_query")) && glQueryCounter &&
+        glGetQueryObjectui64v)
+    {
+        // a counter with zero bits means the timestamps are not usable
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        ext.timerQuery = bits > 0;
+    }
+}
+
+#endif
@@ -0,0 +1,694 @@
+#ifndef GL_MOCK_H
+#define GL_MOCK_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gl_ext.hpp"
+
+// GL backend for tests on machines without a driver. install() loads glad
+// through a fake proc lookup, so Shader, Texture, Map and friends run
+// unchanged against it. Every mocked call is recorded with its arguments;
+// object names and uniform locations are simulated. Calls that are not mocked
+// resolve to NULL and crash, which is the cue to add them here.
+//
+//   glmock::MockGL& gl = glmock::install();
+//   size_t start = gl.mark();
+//   map.createFloor(shader);
+//   CHECK(gl.count("glDrawArrays", start) <= 10000);
+//   CHECK(gl.redundant("glUseProgram") == 0);
+namespace glmock
+{
+
+struct Call
+{
+    std::string name;
+    std::vector<double> args; // numeric arguments, pointers left out
+    std::string text; // string argument, or the name of a uniform location
+};
+
+class MockGL
+{
+  public:
+    std::vector<Call> calls;
+
+    void reset()
+    {
+        calls.clear();
+        nextName = 1;
+        program = 0;
+        uniformNames.clear();
+        bound.clear();
+        storage.clear();
+        mapped.clear();
+        fenceTimeouts = 0;
+        timestamps.clear();
+        gpuClock = 0;
+        reads = 0;
+    }
+
+    // index to count from, e.g. the start of a pass
+    size_t mark() const { return calls.size(); }
+
+    unsigned int count(const char* name, size_t from = 0) const
+    {
+        unsigned int n = 0;
+        for (size_t i = from; i < calls.size(); ++i)
+            if (calls[i].name == name)
+                ++n;
+        return n;
+    }
+
+    // calls of `name` that set `text` (a uniform name, for glUniform*)
+    unsigned int count(const char* name, const std::string& text,
+                       size_t from = 0) const
+    {
+        unsigned int n = 0;
+        for (size_t i = from; i < calls.size(); ++i)
+            if (calls[i].name == name && calls[i].text == text)
+                ++n;
+        return n;
+    }
+
+    // calls of a state setter that repeat the value already set. The first
+    // `keyArgs` arguments select the state (e.g. 1 for the target of
+    // glBindBuffer), the rest is the value.
+    unsigned int redundant(const char* name, unsigned int keyArgs = 0,
+                           size_t from = 0) const
+    {
+        std::map<std::vector<double>, std::vector<double>> state;
+        unsigned int n = 0;
+        for (size_t i = from; i < calls.size(); ++i)
+        {
+            const Call& call = calls[i];
+            if (call.name != name)
+                continue;
+            size_t split = keyArgs < call.args.size() ? keyArgs
+                                                      : call.args.size();
+            std::vector<double> key(call.args.begin(),
+                                    call.args.begin() + split);
+            std::vector<double> value(call.args.begin() + split,
+                                      call.args.end());
+            std::map<std::vector<double>, std::vector<double>>::iterator it =
+                state.find(key);
+            if (it != state.end() && it->second == value)
+                ++n;
+            state[key] = value;
+        }
+        return n;
+    }
+
+    const Call* last(const char* name) const
+    {
+        for (size_t i = calls.size(); i-- > 0;)
+            if (calls[i].name == name)
+                return &calls[i];
+        return NULL;
+    }
+
+    // bookkeeping for the fake entry points
+    // -------------------------------------
+    void record(const char* name, std::initializer_list<double> args,
+                const std::string& text = std::string())
+    {
+        Call call;
+        call.name = name;
+        call.args = args;
+        call.text = text;
+        calls.push_back(call);
+    }
+
+    GLuint newName() { return nextName++; }
+
+    GLint uniformLocation(GLuint program, const char* name)
+    {
+        std::vector<std::string>& names = uniformNames[program];
+        for (unsigned int i = 0; i < names.size(); ++i)
+            if (names[i] == name)
+                return (GLint)i;
+        names.push_back(name);
+        return (GLint)names.size() - 1;
+    }
+
+    std::string uniformName(GLint location) const
+    {
+        std::map<GLuint, std::vector<std::string>>::const_iterator it =
+            uniformNames.find(program);
+        if (location < 0 || it == uniformNames.end() ||
+            location >= (GLint)it->second.size())
+            return std::string();
+        return it->second[location];
+    }
+
+    // buffer contents, so mapped pointers can be written through
+    std::vector<unsigned char>& boundStorage(GLenum target)
+    {
+        return storage[bound[target]];
+    }
+
+    GLuint program = 0; // current program, for uniform names
+    std::map<GLenum, GLuint> bound; // buffer per target
+    std::map<GLuint, bool> mapped;  // whether a buffer is mapped now
+    std::map<GLuint, std::vector<unsigned char>> storage;
+    // glClientWaitSync times out this many times before a fence signals
+    unsigned int fenceTimeouts = 0;
+    // glQueryCounter results; the clock advances 1 ms per counter
+    std::map<GLuint, GLuint64> timestamps;
+    GLuint64 gpuClock = 0;
+    // glReadPixels calls so far; each fills RGBA (x, y, reads, 255), rows
+    // bottom-up as GL has them
+    unsigned int reads = 0;
+
+    bool anyMapped() const
+    {
+        for (const auto& buffer : mapped)
+            if (buffer.second)
+                return true;
+        return false;
+    }
+
+  private:
+    GLuint nextName = 1;
+    std::map<GLuint, std::vector<std::string>> uniformNames;
+};
+
+inline MockGL& mock()
+{
+    static MockGL gl;
+    return gl;
+}
+
+// fake entry points
+// -----------------
+#define GLMOCK_RECORD(...) mock().record(__func__ + 5, __VA_ARGS__)
+
+inline const GLubyte* APIENTRY mock_glGetString(GLenum name)
+{
+    switch (name)
+    {
+    case GL_VERSION:
+        return (const GLubyte*)"4.5 mock";
+    case GL_VENDOR:
+    case GL_RENDERER:
+        return (const GLubyte*)"mock";
+    case GL_SHADING_LANGUAGE_VERSION:
+        return (const GLubyte*)"4.50";
+    default:
+        return (const GLubyte*)"";
+    }
+}
+
+// glad refuses a context without extensions, so there is one
+inline const GLubyte* APIENTRY mock_glGetStringi(GLenum, GLuint)
+{
+    return (const GLubyte*)"GL_MOCK_context";
+}
+
+inline void APIENTRY mock_glGetIntegerv(GLenum name, GLint* data)
+{
+    *data = name == GL_NUM_EXTENSIONS ? 1 : 0;
+}
+
+// the GPU clock of the timer queries, see MockGL::gpuClock
+inline void APIENTRY mock_glGetInteger64v(GLenum name, GLint64* data)
+{
+    *data = name == GL_TIMESTAMP ? (GLint64)mock().gpuClock : 0;
+}
+
+inline GLenum APIENTRY mock_glGetError() { return GL_NO_ERROR; }
+
+inline void APIENTRY mock_glEnable(GLenum cap)
+{
+    GLMOCK_RECORD({(double)cap});
+}
+inline void APIENTRY mock_glDisable(GLenum cap)
+{
+    GLMOCK_RECORD({(double)cap});
+}
+inline void APIENTRY mock_glClear(GLbitfield mask)
+{
+    GLMOCK_RECORD({(double)mask});
+}
+inline void APIENTRY mock_glClearColor(GLfloat r, GLfloat g, GLfloat b,
+                                       GLfloat a)
+{
+    GLMOCK_RECORD({r, g, b, a});
+}
+inline void APIENTRY mock_glViewport(GLint x, GLint y, GLsizei w, GLsizei h)
+{
+    GLMOCK_RECORD({(double)x, (double)y, (double)w, (double)h});
+}
+
+// shaders
+inline GLuint APIENTRY mock_glCreateShader(GLenum type)
+{
+    GLuint name = mock().newName();
+    GLMOCK_RECORD({(double)type, (double)name});
+    return name;
+}
+inline void APIENTRY mock_glShaderSource(GLuint shader, GLsizei count,
+                                         const GLchar* const* source,
+                                         const GLint*)
+{
+    GLMOCK_RECORD({(double)shader, (double)count},
+                  count > 0 ? source[0] : "");
+}
+inline void APIENTRY mock_glCompileShader(GLuint shader)
+{
+    GLMOCK_RECORD({(double)shader});
+}
+inline void APIENTRY mock_glGetShaderiv(GLuint, GLenum, GLint* params)
+{
+    *params = GL_TRUE; // compile status; no info log
+}
+inline void APIENTRY mock_glGetShaderInfoLog(GLuint, GLsizei size,
+                                             GLsizei* length, GLchar* log)
+{
+    if (length)
+        *length = 0;
+    if (size > 0)
+        log[0] = '\0';
+}
+inline GLuint APIENTRY mock_glCreateProgram()
+{
+    GLuint name = mock().newName();
+    GLMOCK_RECORD({(double)name});
+    return name;
+}
+inline void APIENTRY mock_glAttachShader(GLuint program, GLuint shader)
+{
+    GLMOCK_RECORD({(double)program, (double)shader});
+}
+inline void APIENTRY mock_glLinkProgram(GLuint program)
+{
+    GLMOCK_RECORD({(double)program});
+}
+inline void APIENTRY mock_glGetProgramiv(GLuint, GLenum, GLint* params)
+{
+    *params = GL_TRUE; // link and completion status
+}
+inline void APIENTRY mock_glGetProgramInfoLog(GLuint, GLsizei size,
+                                              GLsizei* length, GLchar* log)
+{
+    mock_glGetShaderInfoLog(0, size, length, log);
+}
+inline void APIENTRY mock_glDeleteShader(GLuint shader)
+{
+    GLMOCK_RECORD({(double)shader});
+}
+inline void APIENTRY mock_glDeleteProgram(GLuint program)
+{
+    GLMOCK_RECORD({(double)program});
+}
+inline void APIENTRY mock_glUseProgram(GLuint program)
+{
+    mock().program = program;
+    GLMOCK_RECORD({(double)program});
+}
+inline GLint APIENTRY mock_glGetUniformLocation(GLuint program,
+                                                const GLchar* name)
+{
+    GLint location = mock().uniformLocation(program, name);
+    GLMOCK_RECORD({(double)program, (double)location}, name);
+    return location;
+}
+
+// uniforms are recorded with the uniform name of the current program
+#define GLMOCK_UNIFORM(Name, Params, ...)                                      \
+    inline void APIENTRY mock_gl##Name Params                                  \
+    {                                                                          \
+        mock().record("gl" #Name, {(double)location, __VA_ARGS__},             \
+                      mock().uniformName(location));                           \
+    }
+GLMOCK_UNIFORM(Uniform1i, (GLint location, GLint v0), (double)v0)
+GLMOCK_UNIFORM(Uniform1f, (GLint location, GLfloat v0), v0)
+GLMOCK_UNIFORM(Uniform2f, (GLint location, GLfloat v0, GLfloat v1), v0, v1)
+GLMOCK_UNIFORM(Uniform3f,
+               (GLint location, GLfloat v0, GLfloat v1, GLfloat v2), v0, v1,
+               v2)
+GLMOCK_UNIFORM(Uniform4f,
+               (GLint location, GLfloat v0, GLfloat v1, GLfloat v2,
+                GLfloat v3),
+               v0, v1, v2, v3)
+GLMOCK_UNIFORM(Uniform2fv, (GLint location, GLsizei n, const GLfloat* v),
+               (double)n, v[0], v[1])
+GLMOCK_UNIFORM(Uniform3fv, (GLint location, GLsizei n, const GLfloat* v),
+               (double)n, v[0], v[1], v[2])
+GLMOCK_UNIFORM(Uniform4fv, (GLint location, GLsizei n, const GLfloat* v),
+               (double)n, v[0], v[1], v[2], v[3])
+GLMOCK_UNIFORM(UniformMatrix2fv,
+               (GLint location, GLsizei n, GLboolean, const GLfloat*),
+               (double)n)
+GLMOCK_UNIFORM(UniformMatrix3fv,
+               (GLint location, GLsizei n, GLboolean, const GLfloat*),
+               (double)n)
+GLMOCK_UNIFORM(UniformMatrix4fv,
+               (GLint location, GLsizei n, GLboolean, const GLfloat* v),
+               (double)n, v[12], v[13], v[14])
+#undef GLMOCK_UNIFORM
+
+// textures
+inline void APIENTRY mock_glGenTextures(GLsizei n, GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i)
+        names[i] = mock().newName();
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glDeleteTextures(GLsizei n, const GLuint*)
+{
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glActiveTexture(GLenum unit)
+{
+    GLMOCK_RECORD({(double)unit});
+}
+inline void APIENTRY mock_glBindTexture(GLenum target, GLuint texture)
+{
+    GLMOCK_RECORD({(double)target, (double)texture});
+}
+inline void APIENTRY mock_glTexParameteri(GLenum target, GLenum name,
+                                          GLint value)
+{
+    GLMOCK_RECORD({(double)target, (double)name, (double)value});
+}
+inline void APIENTRY mock_glTexImage2D(GLenum target, GLint level,
+                                       GLint internalFormat, GLsizei width,
+                                       GLsizei height, GLint, GLenum format,
+                                       GLenum type, const void*)
+{
+    GLMOCK_RECORD({(double)target, (double)level, (double)internalFormat,
+                   (double)width, (double)height, (double)format,
+                   (double)type});
+}
+inline void APIENTRY mock_glGenerateMipmap(GLenum target)
+{
+    GLMOCK_RECORD({(double)target});
+}
+inline void APIENTRY mock_glPixelStorei(GLenum name, GLint value)
+{
+    GLMOCK_RECORD({(double)name, (double)value});
+}
+
+// buffers and vertex arrays
+inline void APIENTRY mock_glGenBuffers(GLsizei n, GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i)
+        names[i] = mock().newName();
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glDeleteBuffers(GLsizei n, const GLuint*)
+{
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glBindBuffer(GLenum target, GLuint buffer)
+{
+    mock().bound[target] = buffer;
+    GLMOCK_RECORD({(double)target, (double)buffer});
+}
+// data is not copied; a new store (orphaning) starts zeroed
+inline void APIENTRY mock_glBufferData(GLenum target, GLsizeiptr size,
+                                       const void*, GLenum usage)
+{
+    mock().boundStorage(target).assign(size, 0);
+    GLMOCK_RECORD({(double)target, (double)size, (double)usage});
+}
+inline void APIENTRY mock_glBufferStorage(GLenum target, GLsizeiptr size,
+                                          const void*, GLbitfield flags)
+{
+    mock().boundStorage(target).assign(size, 0);
+    GLMOCK_RECORD({(double)target, (double)size, (double)flags});
+}
+inline void* APIENTRY mock_glMapBufferRange(GLenum target, GLintptr offset,
+                                            GLsizeiptr length,
+                                            GLbitfield access)
+{
+    std::vector<unsigned char>& data = mock().boundStorage(target);
+    GLMOCK_RECORD(
+        {(double)target, (double)offset, (double)length, (double)access});
+    if (offset + length > (GLintptr)data.size())
+        return NULL;
+    mock().mapped[mock().bound[target]] = true;
+    return &data[offset];
+}
+inline GLboolean APIENTRY mock_glUnmapBuffer(GLenum target)
+{
+    mock().mapped[mock().bound[target]] = false;
+    GLMOCK_RECORD({(double)target});
+    return GL_TRUE;
+}
+inline void APIENTRY mock_glBufferSubData(GLenum target, GLintptr offset,
+                                          GLsizeiptr size, const void*)
+{
+    GLMOCK_RECORD({(double)target, (double)offset, (double)size});
+}
+inline void APIENTRY mock_glGenVertexArrays(GLsizei n, GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i)
+        names[i] = mock().newName();
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glDeleteVertexArrays(GLsizei n, const GLuint*)
+{
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glBindVertexArray(GLuint array)
+{
+    GLMOCK_RECORD({(double)array});
+}
+inline void APIENTRY mock_glVertexAttribPointer(GLuint index, GLint size,
+                                                GLenum type, GLboolean,
+                                                GLsizei stride, const void*)
+{
+    GLMOCK_RECORD(
+        {(double)index, (double)size, (double)type, (double)stride});
+}
+inline void APIENTRY mock_glEnableVertexAttribArray(GLuint index)
+{
+    GLMOCK_RECORD({(double)index});
+}
+
+// framebuffer readback; see MockGL::reads
+inline void APIENTRY mock_glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    GLMOCK_RECORD({(double)target, (double)framebuffer});
+}
+inline void APIENTRY mock_glReadBuffer(GLenum mode)
+{
+    GLMOCK_RECORD({(double)mode});
+}
+inline void APIENTRY mock_glReadPixels(GLint x, GLint y, GLsizei width,
+                                       GLsizei height, GLenum format,
+                                       GLenum type, void* pixels)
+{
+    MockGL& gl = mock();
+    GLMOCK_RECORD({(double)x, (double)y, (double)width, (double)height,
+                   (double)format, (double)type});
+    const unsigned int read = ++gl.reads;
+    if (format != GL_RGBA || type != GL_UNSIGNED_BYTE)
+        return;
+    // with a pack buffer bound, `pixels` is an offset into it
+    unsigned char* out = (unsigned char*)pixels;
+    GLuint pack = gl.bound[GL_PIXEL_PACK_BUFFER];
+    if (pack)
+    {
+        std::vector<unsigned char>& data = gl.storage[pack];
+        size_t offset = (size_t)pixels;
+        if (offset + (size_t)width * height * 4 > data.size())
+            return;
+        out = &data[offset];
+    }
+    for (GLint row = 0; row < height; ++row)
+        for (GLint col = 0; col < width; ++col, out += 4)
+        {
+            out[0] = (unsigned char)(x + col);
+            out[1] = (unsigned char)(y + row);
+            out[2] = (unsigned char)read;
+            out[3] = 255;
+        }
+}
+
+// fences: names only; see MockGL::fenceTimeouts
+inline GLsync APIENTRY mock_glFenceSync(GLenum condition, GLbitfield)
+{
+    GLuint name = mock().newName();
+    GLMOCK_RECORD({(double)condition, (double)name});
+    return (GLsync)(uintptr_t)name;
+}
+inline GLenum APIENTRY mock_glClientWaitSync(GLsync sync, GLbitfield flags,
+                                             GLuint64 timeout)
+{
+    GLMOCK_RECORD({(double)(uintptr_t)sync, (double)flags, (double)timeout});
+    if (mock().fenceTimeouts == 0)
+        return GL_ALREADY_SIGNALED;
+    --mock().fenceTimeouts;
+    return GL_TIMEOUT_EXPIRED;
+}
+inline void APIENTRY mock_glDeleteSync(GLsync sync)
+{
+    GLMOCK_RECORD({(double)(uintptr_t)sync});
+}
+
+// timer queries
+inline void APIENTRY mock_glGenQueries(GLsizei n, GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i)
+        names[i] = mock().newName();
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glDeleteQueries(GLsizei n, const GLuint*)
+{
+    GLMOCK_RECORD({(double)n});
+}
+inline void APIENTRY mock_glQueryCounter(GLuint query, GLenum target)
+{
+    mock().gpuClock += 1000000;
+    mock().timestamps[query] = mock().gpuClock;
+    GLMOCK_RECORD({(double)query, (double)target});
+}
+inline void APIENTRY mock_glGetQueryiv(GLenum, GLenum name, GLint* params)
+{
+    *params = name == GL_QUERY_COUNTER_BITS ? 64 : 0;
+}
+inline void APIENTRY mock_glGetQueryObjectiv(GLuint query, GLenum,
+                                             GLint* params)
+{
+    *params = GL_TRUE; // every result is available at once
+    GLMOCK_RECORD({(double)query});
+}
+inline void APIENTRY mock_glGetQueryObjectui64v(GLuint query, GLenum,
+                                                GLuint64* params)
+{
+    std::map<GLuint, GLuint64>::const_iterator it =
+        mock().timestamps.find(query);
+    *params = it != mock().timestamps.end() ? it->second : 0;
+    GLMOCK_RECORD({(double)query});
+}
+
+// draws
+inline void APIENTRY mock_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    GLMOCK_RECORD({(double)mode, (double)first, (double)count});
+}
+inline void APIENTRY mock_glDrawElements(GLenum mode, GLsizei count,
+                                         GLenum type, const void*)
+{
+    GLMOCK_RECORD({(double)mode, (double)count, (double)type});
+}
+inline void APIENTRY mock_glDrawArraysInstanced(GLenum mode, GLint first,
+                                                GLsizei count,
+                                                GLsizei instances)
+{
+    GLMOCK_RECORD(
+        {(double)mode, (double)first, (double)count, (double)instances});
+}
+inline void APIENTRY mock_glDrawElementsInstanced(GLenum mode, GLsizei count,
+                                                  GLenum type, const void*,
+                                                  GLsizei instances)
+{
+    GLMOCK_RECORD(
+        {(double)mode, (double)count, (double)type, (double)instances});
+}
+
+#undef GLMOCK_RECORD
+
+// the GLADloadproc
+inline void* getProcAddress(const char* name)
+{
+#define GLMOCK_PROC(Name)                                                      \
+    if (std::strcmp(name, #Name) == 0)                                         \
+        return (void*)mock_##Name;
+    GLMOCK_PROC(glGetString)
+    GLMOCK_PROC(glGetStringi)
+    GLMOCK_PROC(glGetIntegerv)
+    GLMOCK_PROC(glGetInteger64v)
+    GLMOCK_PROC(glGetError)
+    GLMOCK_PROC(glEnable)
+    GLMOCK_PROC(glDisable)
+    GLMOCK_PROC(glClear)
+    GLMOCK_PROC(glClearColor)
+    GLMOCK_PROC(glViewport)
+    GLMOCK_PROC(glCreateShader)
+    GLMOCK_PROC(glShaderSource)
+    GLMOCK_PROC(glCompileShader)
+    GLMOCK_PROC(glGetShaderiv)
+    GLMOCK_PROC(glGetShaderInfoLog)
+    GLMOCK_PROC(glCreateProgram)
+    GLMOCK_PROC(glAttachShader)
+    GLMOCK_PROC(glLinkProgram)
+    GLMOCK_PROC(glGetProgramiv)
+    GLMOCK_PROC(glGetProgramInfoLog)
+    GLMOCK_PROC(glDeleteShader)
+    GLMOCK_PROC(glDeleteProgram)
+    GLMOCK_PROC(glUseProgram)
+    GLMOCK_PROC(glGetUniformLocation)
+    GLMOCK_PROC(glUniform1i)
+    GLMOCK_PROC(glUniform1f)
+    GLMOCK_PROC(glUniform2f)
+    GLMOCK_PROC(glUniform3f)
+    GLMOCK_PROC(glUniform4f)
+    GLMOCK_PROC(glUniform2fv)
+    GLMOCK_PROC(glUniform3fv)
+    GLMOCK_PROC(glUniform4fv)
+    GLMOCK_PROC(glUniformMatrix2fv)
+    GLMOCK_PROC(glUniformMatrix3fv)
+    GLMOCK_PROC(glUniformMatrix4fv)
+    GLMOCK_PROC(glGenTextures)
+    GLMOCK_PROC(glDeleteTextures)
+    GLMOCK_PROC(glActiveTexture)
+    GLMOCK_PROC(glBindTexture)
+    GLMOCK_PROC(glTexParameteri)
+    GLMOCK_PROC(glTexImage2D)
+    GLMOCK_PROC(glGenerateMipmap)
+    GLMOCK_PROC(glPixelStorei)
+    GLMOCK_PROC(glGenBuffers)
+    GLMOCK_PROC(glDeleteBuffers)
+    GLMOCK_PROC(glBindBuffer)
+    GLMOCK_PROC(glBufferData)
+    GLMOCK_PROC(glBufferSubData)
+    GLMOCK_PROC(glBufferStorage)
+    GLMOCK_PROC(glMapBufferRange)
+    GLMOCK_PROC(glUnmapBuffer)
+    GLMOCK_PROC(glBindFramebuffer)
+    GLMOCK_PROC(glReadBuffer)
+    GLMOCK_PROC(glReadPixels)
+    GLMOCK_PROC(glFenceSync)
+    GLMOCK_PROC(glClientWaitSync)
+    GLMOCK_PROC(glDeleteSync)
+    GLMOCK_PROC(glGenVertexArrays)
+    GLMOCK_PROC(glDeleteVertexArrays)
+    GLMOCK_PROC(glBindVertexArray)
+    GLMOCK_PROC(glVertexAttribPointer)
+    GLMOCK_PROC(glEnableVertexAttribArray)
+    GLMOCK_PROC(glGenQueries)
+    GLMOCK_PROC(glDeleteQueries)
+    GLMOCK_PROC(glQueryCounter)
+    GLMOCK_PROC(glGetQueryiv)
+    GLMOCK_PROC(glGetQueryObjectiv)
+    GLMOCK_PROC(glGetQueryObjectui64v)
+    GLMOCK_PROC(glDrawArrays)
+    GLMOCK_PROC(glDrawElements)
+    GLMOCK_PROC(glDrawArraysInstanced)
+    GLMOCK_PROC(glDrawElementsInstanced)
+#undef GLMOCK_PROC
+    return NULL;
+}
+
+// points glad at the mock and clears the call log
+inline MockGL& install()
+{
+    mock().reset();
+    gladLoadGLLoader(getProcAddress);
+    loadGLExtensions(getProcAddress);
+    mock().calls.clear();
+    return mock();
+}
+
+} // namespace glmock
+
+#endif
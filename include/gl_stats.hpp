@@ -0,0 +1,458 @@
+#ifndef GL_STATS_H
+#define GL_STATS_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <utility>
+
+// Debug and statistics layer over the glad function pointers. install()
+// swaps the glad_gl* pointers of the calls we care about for wrappers that
+// count them and then call the driver, so no call site has to change.
+//
+// Per frame it counts draw calls, vertices, state changes, buffer upload
+// bytes and uniform updates. With `check` it also flags state sets that
+// change nothing (judged against what was last set through this layer) and
+// calls glGetError after every wrapped call.
+struct GLCounters
+{
+    unsigned long draws = 0;
+    unsigned long long vertices = 0; // vertices submitted, times instances
+    unsigned long stateChanges = 0;
+    unsigned long redundantStateChanges = 0; // only counted with `check`
+    unsigned long long bufferBytes = 0;
+    unsigned long uniformUpdates = 0;
+    unsigned long uniformLookups = 0; // glGetUniformLocation
+    unsigned long errors = 0;         // only counted with `check`
+
+    void add(const GLCounters& other)
+    {
+        draws += other.draws;
+        vertices += other.vertices;
+        stateChanges += other.stateChanges;
+        redundantStateChanges += other.redundantStateChanges;
+        bufferBytes += other.bufferBytes;
+        uniformUpdates += other.uniformUpdates;
+        uniformLookups += other.uniformLookups;
+        errors += other.errors;
+    }
+};
+
+class GLStats
+{
+  public:
+    // the driver entry points the wrappers forward to
+    struct Real
+    {
+        PFNGLDRAWARRAYSPROC DrawArrays = NULL;
+        PFNGLDRAWELEMENTSPROC DrawElements = NULL;
+        PFNGLDRAWARRAYSINSTANCEDPROC DrawArraysInstanced = NULL;
+        PFNGLDRAWELEMENTSINSTANCEDPROC DrawElementsInstanced = NULL;
+        PFNGLUSEPROGRAMPROC UseProgram = NULL;
+        PFNGLBINDVERTEXARRAYPROC BindVertexArray = NULL;
+        PFNGLACTIVETEXTUREPROC ActiveTexture = NULL;
+        PFNGLBINDTEXTUREPROC BindTexture = NULL;
+        PFNGLBINDBUFFERPROC BindBuffer = NULL;
+        PFNGLBINDFRAMEBUFFERPROC BindFramebuffer = NULL;
+        PFNGLENABLEPROC Enable = NULL;
+        PFNGLDISABLEPROC Disable = NULL;
+        PFNGLBUFFERDATAPROC BufferData = NULL;
+        PFNGLBUFFERSUBDATAPROC BufferSubData = NULL;
+        PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation = NULL;
+        PFNGLUNIFORM1IPROC Uniform1i = NULL;
+        PFNGLUNIFORM1FPROC Uniform1f = NULL;
+        PFNGLUNIFORM2FPROC Uniform2f = NULL;
+        PFNGLUNIFORM3FPROC Uniform3f = NULL;
+        PFNGLUNIFORM4FPROC Uniform4f = NULL;
+        PFNGLUNIFORM2FVPROC Uniform2fv = NULL;
+        PFNGLUNIFORM3FVPROC Uniform3fv = NULL;
+        PFNGLUNIFORM4FVPROC Uniform4fv = NULL;
+        PFNGLUNIFORMMATRIX2FVPROC UniformMatrix2fv = NULL;
+        PFNGLUNIFORMMATRIX3FVPROC UniformMatrix3fv = NULL;
+        PFNGLUNIFORMMATRIX4FVPROC UniformMatrix4fv = NULL;
+    };
+
+    Real real;
+    bool check = false;
+    GLCounters frame; // the frame being recorded
+    GLCounters last;  // the previous complete frame
+    GLCounters total;
+    unsigned long frames = 0;
+
+    // call after gladLoadGLLoader, on the context's thread
+    void install(bool check = false);
+    void uninstall();
+    bool installed() const { return hooked; }
+
+    // closes the current frame; writes a CSV row if dumpTo() was called
+    void endFrame()
+    {
+        last = frame;
+        total.add(frame);
+        if (dump)
+            std::fprintf(dump, "%lu,%lu,%llu,%lu,%lu,%llu,%lu,%lu,%lu\n",
+                         frames, frame.draws, frame.vertices,
+                         frame.stateChanges, frame.redundantStateChanges,
+                         frame.bufferBytes, frame.uniformUpdates,
+                         frame.uniformLookups, frame.errors);
+        frame = GLCounters();
+        ++frames;
+    }
+
+    // per-frame counters as CSV, one row per endFrame()
+    bool dumpTo(const char* path)
+    {
+        closeDump();
+        dump = std::fopen(path, "w");
+        if (!dump)
+        {
+            std::cout << "ERROR::GL_STATS::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        std::fprintf(dump, "frame,draws,vertices,state_changes,redundant,"
+                           "buffer_bytes,uniforms,uniform_lookups,errors\n");
+        return true;
+    }
+
+    void closeDump()
+    {
+        if (dump)
+            std::fclose(dump);
+        dump = NULL;
+    }
+
+    void print(std::ostream& out) const
+    {
+        if (!frames)
+            return;
+        char line[300];
+        double n = (double)frames;
+        std::snprintf(line, sizeof(line),
+                      "gl per frame: %.1f draws, %.0f vertices, %.1f state "
+                      "changes (%.1f redundant), %.0f buffer bytes, %.1f "
+                      "uniforms, %.1f uniform lookups",
+                      total.draws / n, total.vertices / n,
+                      total.stateChanges / n, total.redundantStateChanges / n,
+                      total.bufferBytes / n, total.uniformUpdates / n,
+                      total.uniformLookups / n);
+        out << line << std::endl;
+        for (std::map<const char*, unsigned long>::const_iterator it =
+                 redundantCalls.begin();
+             it != redundantCalls.end(); ++it)
+            out << "  redundant " << it->first << ": " << it->second
+                << std::endl;
+        if (total.errors)
+            out << "  gl errors: " << total.errors << std::endl;
+    }
+
+    // wrapper helpers
+    // ---------------
+    void stateChange(const char* call, bool redundant)
+    {
+        ++frame.stateChanges;
+        if (check && redundant)
+        {
+            ++frame.redundantStateChanges;
+            ++redundantCalls[call];
+        }
+    }
+
+    void afterCall(const char* call)
+    {
+        if (!check)
+            return;
+        for (GLenum error = glGetError(); error != GL_NO_ERROR;
+             error = glGetError())
+        {
+            ++frame.errors;
+            char code[16];
+            std::snprintf(code, sizeof(code), "0x%04X", error);
+            std::cout << "ERROR::GL::" << call << ": " << code << std::endl;
+        }
+    }
+
+    // state last set through the layer, for the redundancy check
+    GLuint program = 0, vertexArray = 0;
+    GLenum activeTexture = GL_TEXTURE0;
+    std::map<std::pair<GLenum, GLenum>, GLuint> textures; // (unit, target)
+    std::map<GLenum, GLuint> buffers;
+    std::map<GLenum, GLuint> framebuffers;
+    std::map<GLenum, bool> capabilities;
+
+  private:
+    bool hooked = false;
+    FILE* dump = NULL;
+    std::map<const char*, unsigned long> redundantCalls;
+};
+
+inline GLStats& glStats()
+{
+    static GLStats stats;
+    return stats;
+}
+
+namespace gl_stats
+{
+
+// state is tracked before the call goes out, so the first set of anything is
+// never considered redundant
+template <typename K>
+inline bool track(std::map<K, GLuint>& state, const K& key, GLuint value)
+{
+    typename std::map<K, GLuint>::iterator it = state.find(key);
+    bool same = it != state.end() && it->second == value;
+    state[key] = value;
+    return same;
+}
+
+inline void APIENTRY DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    GLStats& s = glStats();
+    s.real.DrawArrays(mode, first, count);
+    ++s.frame.draws;
+    s.frame.vertices += count;
+    s.afterCall("glDrawArrays");
+}
+
+inline void APIENTRY DrawElements(GLenum mode, GLsizei count, GLenum type,
+                                  const void* indices)
+{
+    GLStats& s = glStats();
+    s.real.DrawElements(mode, count, type, indices);
+    ++s.frame.draws;
+    s.frame.vertices += count;
+    s.afterCall("glDrawElements");
+}
+
+inline void APIENTRY DrawArraysInstanced(GLenum mode, GLint first,
+                                         GLsizei count, GLsizei instances)
+{
+    GLStats& s = glStats();
+    s.real.DrawArraysInstanced(mode, first, count, instances);
+    ++s.frame.draws;
+    s.frame.vertices += (unsigned long long)count * instances;
+    s.afterCall("glDrawArraysInstanced");
+}
+
+inline void APIENTRY DrawElementsInstanced(GLenum mode, GLsizei count,
+                                           GLenum type, const void* indices,
+                                           GLsizei instances)
+{
+    GLStats& s = glStats();
+    s.real.DrawElementsInstanced(mode, count, type, indices, instances);
+    ++s.frame.draws;
+    s.frame.vertices += (unsigned long long)count * instances;
+    s.afterCall("glDrawElementsInstanced");
+}
+
+inline void APIENTRY UseProgram(GLuint program)
+{
+    GLStats& s = glStats();
+    s.stateChange("glUseProgram", s.program == program);
+    s.program = program;
+    s.real.UseProgram(program);
+    s.afterCall("glUseProgram");
+}
+
+inline void APIENTRY BindVertexArray(GLuint array)
+{
+    GLStats& s = glStats();
+    s.stateChange("glBindVertexArray", s.vertexArray == array);
+    s.vertexArray = array;
+    // the element array binding is part of the VAO
+    s.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    s.real.BindVertexArray(array);
+    s.afterCall("glBindVertexArray");
+}
+
+inline void APIENTRY ActiveTexture(GLenum unit)
+{
+    GLStats& s = glStats();
+    s.stateChange("glActiveTexture", s.activeTexture == unit);
+    s.activeTexture = unit;
+    s.real.ActiveTexture(unit);
+    s.afterCall("glActiveTexture");
+}
+
+inline void APIENTRY BindTexture(GLenum target, GLuint texture)
+{
+    GLStats& s = glStats();
+    s.stateChange("glBindTexture",
+                  track(s.textures, std::make_pair(s.activeTexture, target),
+                        texture));
+    s.real.BindTexture(target, texture);
+    s.afterCall("glBindTexture");
+}
+
+inline void APIENTRY BindBuffer(GLenum target, GLuint buffer)
+{
+    GLStats& s = glStats();
+    s.stateChange("glBindBuffer", track(s.buffers, target, buffer));
+    s.real.BindBuffer(target, buffer);
+    s.afterCall("glBindBuffer");
+}
+
+inline void APIENTRY BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    GLStats& s = glStats();
+    bool same;
+    if (target == GL_FRAMEBUFFER)
+    {
+        same = track(s.framebuffers, (GLenum)GL_DRAW_FRAMEBUFFER, framebuffer);
+        same = track(s.framebuffers, (GLenum)GL_READ_FRAMEBUFFER,
+                     framebuffer) &&
+               same;
+    }
+    else
+        same = track(s.framebuffers, target, framebuffer);
+    s.stateChange("glBindFramebuffer", same);
+    s.real.BindFramebuffer(target, framebuffer);
+    s.afterCall("glBindFramebuffer");
+}
+
+inline void setCapability(const char* call, GLenum cap, bool enabled)
+{
+    GLStats& s = glStats();
+    std::map<GLenum, bool>::iterator it = s.capabilities.find(cap);
+    s.stateChange(call, it != s.capabilities.end() && it->second == enabled);
+    s.capabilities[cap] = enabled;
+}
+
+inline void APIENTRY Enable(GLenum cap)
+{
+    setCapability("glEnable", cap, true);
+    glStats().real.Enable(cap);
+    glStats().afterCall("glEnable");
+}
+
+inline void APIENTRY Disable(GLenum cap)
+{
+    setCapability("glDisable", cap, false);
+    glStats().real.Disable(cap);
+    glStats().afterCall("glDisable");
+}
+
+inline void APIENTRY BufferData(GLenum target, GLsizeiptr size,
+                                const void* data, GLenum usage)
+{
+    GLStats& s = glStats();
+    s.real.BufferData(target, size, data, usage);
+    // a NULL store only allocates (or orphans)
+    if (data)
+        s.frame.bufferBytes += size;
+    s.afterCall("glBufferData");
+}
+
+inline void APIENTRY BufferSubData(GLenum target, GLintptr offset,
+                                   GLsizeiptr size, const void* data)
+{
+    GLStats& s = glStats();
+    s.real.BufferSubData(target, offset, size, data);
+    s.frame.bufferBytes += size;
+    s.afterCall("glBufferSubData");
+}
+
+inline GLint APIENTRY GetUniformLocation(GLuint program, const GLchar* name)
+{
+    GLStats& s = glStats();
+    GLint location = s.real.GetUniformLocation(program, name);
+    ++s.frame.uniformLookups;
+    s.afterCall("glGetUniformLocation");
+    return location;
+}
+
+#define GL_STATS_UNIFORM(Name, Params, Args)                                   \
+    inline void APIENTRY Name Params                                           \
+    {                                                                          \
+        GLStats& s = glStats();                                                \
+        s.real.Name Args;                                                      \
+        ++s.frame.uniformUpdates;                                              \
+        s.afterCall("gl" #Name);                                               \
+    }
+
+GL_STATS_UNIFORM(Uniform1i, (GLint l, GLint v0), (l, v0))
+GL_STATS_UNIFORM(Uniform1f, (GLint l, GLfloat v0), (l, v0))
+GL_STATS_UNIFORM(Uniform2f, (GLint l, GLfloat v0, GLfloat v1), (l, v0, v1))
+GL_STATS_UNIFORM(Uniform3f, (GLint l, GLfloat v0, GLfloat v1, GLfloat v2),
+                 (l, v0, v1, v2))
+GL_STATS_UNIFORM(Uniform4f,
+                 (GLint l, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3),
+                 (l, v0, v1, v2, v3))
+GL_STATS_UNIFORM(Uniform2fv, (GLint l, GLsizei n, const GLfloat* v), (l, n, v))
+GL_STATS_UNIFORM(Uniform3fv, (GLint l, GLsizei n, const GLfloat* v), (l, n, v))
+GL_STATS_UNIFORM(Uniform4fv, (GLint l, GLsizei n, const GLfloat* v), (l, n, v))
+GL_STATS_UNIFORM(UniformMatrix2fv,
+                 (GLint l, GLsizei n, GLboolean t, const GLfloat* v),
+                 (l, n, t, v))
+GL_STATS_UNIFORM(UniformMatrix3fv,
+                 (GLint l, GLsizei n, GLboolean t, const GLfloat* v),
+                 (l, n, t, v))
+GL_STATS_UNIFORM(UniformMatrix4fv,
+                 (GLint l, GLsizei n, GLboolean t, const GLfloat* v),
+                 (l, n, t, v))
+
+#undef GL_STATS_UNIFORM
+
+} // namespace gl_stats
+
+#define GL_STATS_HOOKS(HOOK)                                                   \
+    HOOK(DrawArrays)                                                           \
+    HOOK(DrawElements)                                                         \
+    HOOK(DrawArraysInstanced)                                                  \
+    HOOK(DrawElementsInstanced)                                                \
+    HOOK(UseProgram)                                                           \
+    HOOK(BindVertexArray)                                                      \
+    HOOK(ActiveTexture)                                                        \
+    HOOK(BindTexture)                                                          \
+    HOOK(BindBuffer)                                                           \
+    HOOK(BindFramebuffer)                                                      \
+    HOOK(Enable)                                                               \
+    HOOK(Disable)                                                              \
+    HOOK(BufferData)                                                           \
+    HOOK(BufferSubData)                                                        \
+    HOOK(GetUniformLocation)                                                   \
+    HOOK(Uniform1i)                                                            \
+    HOOK(Uniform1f)                                                            \
+    HOOK(Uniform2f)                                                            \
+    HOOK(Uniform3f)                                                            \
+    HOOK(Uniform4f)                                                            \
+    HOOK(Uniform2fv)                                                           \
+    HOOK(Uniform3fv)                                                           \
+    HOOK(Uniform4fv)                                                           \
+    HOOK(UniformMatrix2fv)                                                     \
+    HOOK(UniformMatrix3fv)                                                     \
+    HOOK(UniformMatrix4fv)
+
+inline void GLStats::install(bool check)
+{
+    if (hooked)
+        return;
+    hooked = true;
+    this->check = check;
+    // entry points the context does not have stay NULL
+#define GL_STATS_INSTALL(Name)                                                 \
+    if (glad_gl##Name)                                                         \
+    {                                                                          \
+        real.Name = glad_gl##Name;                                             \
+        glad_gl##Name = gl_stats::Name;                                        \
+    }
+    GL_STATS_HOOKS(GL_STATS_INSTALL)
+#undef GL_STATS_INSTALL
+}
+
+inline void GLStats::uninstall()
+{
+    if (!hooked)
+        return;
+#define GL_STATS_UNINSTALL(Name)                                               \
+    if (real.Name)                                                             \
+        glad_gl##Name = real.Name;                                             \
+    real.Name = NULL;
+    GL_STATS_HOOKS(GL_STATS_UNINSTALL)
+    hooked = false;
+#undef GL_STATS_UNINSTALL
+}
+
+#endif
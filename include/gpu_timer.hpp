@@ -0,0 +1,213 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "gl_ext.hpp"
+#include "profiler.hpp"
+
+// GPU time of render passes from GL_TIMESTAMP queries (glQueryCounter). Unlike
+// GL_TIME_ELAPSED these can nest and overlap. Every frame uses its own set of
+// queries and a set is only read back `latency` frames later, when the GPU is
+// normally long done with it, so reading the results does not stall. With a
+// profiler build the passes also show up as a "GPU" track in the trace.
+//
+// Without timer query support every call is a no-op.
+class GpuTimer
+{
+  public:
+    struct Pass
+    {
+        const char* name;
+        double lastMs = 0.0;
+        double totalMs = 0.0;
+        unsigned long samples = 0;
+    };
+
+    static const unsigned int NO_QUERY = UINT_MAX;
+
+    // called for every pass time read back, e.g. to feed histograms
+    std::function<void(const char* name, double ms)> onResult;
+
+    GpuTimer() {}
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // needs the GL context and loadGLExtensions(); `maxPasses` is per frame
+    void init(unsigned int latency = 4, unsigned int maxPasses = 16)
+    {
+        shutdown();
+        if (!glExtensions().timerQuery)
+        {
+            std::cout << "gpu timer: timer queries not supported, GPU pass "
+                         "times are not available"
+                      << std::endl;
+            return;
+        }
+        frames.resize(latency);
+        for (unsigned int i = 0; i < frames.size(); ++i)
+        {
+            frames[i].queries.resize(maxPasses * 2);
+            frames[i].names.resize(maxPasses);
+            frames[i].ended.resize(maxPasses);
+            glGenQueries(maxPasses * 2, &frames[i].queries[0]);
+        }
+        cursor = 0;
+#ifdef FPV_PROFILE
+        // GPU and CPU clocks only differ by an offset (drift is ignored)
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        clockOffset = (long long)profiler::now() - (long long)gpuNow;
+        if (!track)
+            track = profiler::createTrack("GPU");
+#endif
+    }
+
+    bool supported() const { return !frames.empty(); }
+
+    // call once at the start of every frame, before the first pass
+    void beginFrame()
+    {
+        if (!supported())
+            return;
+        cursor = (cursor + 1) % frames.size();
+        collect(frames[cursor]);
+    }
+
+    // `name` must outlive the timer, e.g. a string literal; passes are told
+    // apart by the text. Returns the id to pass to end().
+    unsigned int begin(const char* name)
+    {
+        if (!supported())
+            return NO_QUERY;
+        Frame& frame = frames[cursor];
+        if (frame.used == frame.names.size())
+            return NO_QUERY;
+        unsigned int index = frame.used++;
+        frame.names[index] = name;
+        frame.ended[index] = false;
+        glQueryCounter(frame.queries[index * 2], GL_TIMESTAMP);
+        return index;
+    }
+
+    void end(unsigned int index)
+    {
+        if (index == NO_QUERY)
+            return;
+        frames[cursor].ended[index] = true;
+        glQueryCounter(frames[cursor].queries[index * 2 + 1], GL_TIMESTAMP);
+    }
+
+    const std::vector<Pass>& passes() const { return results; }
+    unsigned long stalls() const { return stallCount; }
+
+    void print(std::ostream& out) const
+    {
+        char line[160];
+        for (unsigned int i = 0; i < results.size(); ++i)
+        {
+            const Pass& pass = results[i];
+            std::snprintf(line, sizeof(line),
+                          "gpu %-20s avg %8.3f ms over %lu frames", pass.name,
+                          pass.samples ? pass.totalMs / pass.samples : 0.0,
+                          pass.samples);
+            out << line << std::endl;
+        }
+        if (stallCount)
+            out << "gpu timer: waited for " << stallCount << " frames"
+                << std::endl;
+    }
+
+    // reads whatever is still in flight and frees the queries; call before
+    // the context goes away
+    void shutdown()
+    {
+        for (unsigned int i = 1; i <= frames.size(); ++i)
+            collect(frames[(cursor + i) % frames.size()]);
+        for (unsigned int i = 0; i < frames.size(); ++i)
+            glDeleteQueries((GLsizei)frames[i].queries.size(),
+                            &frames[i].queries[0]);
+        frames.clear();
+    }
+
+  private:
+    struct Frame
+    {
+        std::vector<GLuint> queries; // begin/end pairs
+        std::vector<const char*> names;
+        std::vector<bool> ended; // a pass without end() has no result
+        unsigned int used = 0;
+    };
+
+    std::vector<Frame> frames;
+    unsigned int cursor = 0;
+    std::vector<Pass> results;
+    unsigned long stallCount = 0;
+#ifdef FPV_PROFILE
+    profiler::ThreadBuffer* track = NULL;
+    long long clockOffset = 0;
+#endif
+
+    void collect(Frame& frame)
+    {
+        unsigned int last = frame.used;
+        while (last > 0 && !frame.ended[last - 1])
+            --last;
+        if (last == 0)
+        {
+            frame.used = 0;
+            return;
+        }
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[last * 2 - 1],
+                           GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            ++stallCount; // the read below waits for the GPU
+
+        for (unsigned int i = 0; i < last; ++i)
+        {
+            if (!frame.ended[i])
+                continue;
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT,
+                                  &begin);
+            glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT,
+                                  &end);
+            if (end < begin)
+                end = begin;
+            Pass& pass = find(frame.names[i]);
+            pass.lastMs = (end - begin) / 1e6;
+            pass.totalMs += pass.lastMs;
+            ++pass.samples;
+            if (onResult)
+                onResult(frame.names[i], pass.lastMs);
+#ifdef FPV_PROFILE
+            long long start = (long long)begin + clockOffset;
+            if (start >= 0)
+                track->record(frame.names[i], (uint64_t)start,
+                              (uint64_t)start + (end - begin));
+#endif
+        }
+        frame.used = 0;
+    }
+
+    Pass& find(const char* name)
+    {
+        for (unsigned int i = 0; i < results.size(); ++i)
+            if (std::strcmp(results[i].name, name) == 0)
+                return results[i];
+        Pass pass;
+        pass.name = name;
+        results.push_back(pass);
+        return results.back();
+    }
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef GROUND_FOLLOW_H
+#define GROUND_FOLLOW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <immintrin.h>
+#define FPV_X86 1
+#endif
+
+// Ground following for many objects at once: each eye height eases towards
+// the bilinearly sampled terrain height plus `eyeHeight`,
+//
+//   y += (height(x, z) + eyeHeight - y) * alpha
+//
+// the easing of Person::Update_yPos, alpha = smoothingFactor * deltaTime, but
+// over arrays of x, z and y and between the four corners rather than at the
+// one below. followGround() uses AVX2 with gathers where the CPU has it and
+// the scalar reference elsewhere. Without gathers the corner loads go one
+// lane at a time, and an SSE2 version built that way ran no faster than the
+// scalar loop.
+
+// Heights at the block corners, copied out of Map::heightMap into one flat
+// array, x * depth + z. Positions outside are clamped to the edge.
+struct HeightField
+{
+    int width = 0, depth = 0; // samples along x and z, at least 2 each
+    std::vector<float> heights;
+
+    // the map's width x depth samples; heightMap has a row and a column
+    // more that the terrain never fills, which would pull the edge to 0
+    void build(const std::vector<std::vector<float>>& heightMap, int width,
+               int depth)
+    {
+        this->width = width;
+        this->depth = depth;
+        heights.resize(width * depth);
+        for (int x = 0; x < width; ++x)
+            std::copy(heightMap[x].begin(), heightMap[x].begin() + depth,
+                      heights.begin() + x * depth);
+    }
+
+    float at(int x, int z) const { return heights[x * depth + z]; }
+
+    // bilinear, in the same order of operations as the AVX2 version
+    float sample(float x, float z) const
+    {
+        x = std::min(std::max(x, 0.0f), (float)(width - 1));
+        z = std::min(std::max(z, 0.0f), (float)(depth - 1));
+        int x0 = std::min((int)x, width - 2), z0 = std::min((int)z, depth - 2);
+        float fx = x - x0, fz = z - z0;
+        float a = at(x0, z0) + (at(x0, z0 + 1) - at(x0, z0)) * fz;
+        float b = at(x0 + 1, z0) + (at(x0 + 1, z0 + 1) - at(x0 + 1, z0)) * fz;
+        return a + (b - a) * fx;
+    }
+};
+
+inline void followGroundScalar(const HeightField& field, const float* x,
+                               const float* z, float* y, size_t count,
+                               float eyeHeight, float alpha)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        float target = field.sample(x[i], z[i]) + eyeHeight;
+        y[i] += (target - y[i]) * alpha;
+    }
+}
+
+#ifdef FPV_X86
+// eight at a time with hardware gathers; compiled for AVX2 whatever the
+// build flags, so only call it when cpuHasAvx2()
+__attribute__((target("avx2"))) inline size_t
+followGroundAvx2(const HeightField& field, const float* x, const float* z,
+                 float* y, size_t count, float eyeHeight, float alpha)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 maxX = _mm256_set1_ps((float)(field.width - 1));
+    const __m256 maxZ = _mm256_set1_ps((float)(field.depth - 1));
+    const __m256i lastX = _mm256_set1_epi32(field.width - 2);
+    const __m256i lastZ = _mm256_set1_epi32(field.depth - 2);
+    const __m256i depth = _mm256_set1_epi32(field.depth);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 eye = _mm256_set1_ps(eyeHeight), a = _mm256_set1_ps(alpha);
+    const float* h = &field.heights[0];
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 px =
+            _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(x + i), zero), maxX);
+        __m256 pz =
+            _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(z + i), zero), maxZ);
+        __m256i cx = _mm256_min_epi32(_mm256_cvttps_epi32(px), lastX);
+        __m256i cz = _mm256_min_epi32(_mm256_cvttps_epi32(pz), lastZ);
+        __m256 fx = _mm256_sub_ps(px, _mm256_cvtepi32_ps(cx));
+        __m256 fz = _mm256_sub_ps(pz, _mm256_cvtepi32_ps(cz));
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(cx, depth), cz);
+        __m256 h00 = _mm256_i32gather_ps(h, index, 4);
+        __m256 h01 = _mm256_i32gather_ps(h, _mm256_add_epi32(index, one), 4);
+        index = _mm256_add_epi32(index, depth);
+        __m256 h10 = _mm256_i32gather_ps(h, index, 4);
+        __m256 h11 = _mm256_i32gather_ps(h, _mm256_add_epi32(index, one), 4);
+        __m256 near =
+            _mm256_add_ps(h00, _mm256_mul_ps(_mm256_sub_ps(h01, h00), fz));
+        __m256 far =
+            _mm256_add_ps(h10, _mm256_mul_ps(_mm256_sub_ps(h11, h10), fz));
+        __m256 ground =
+            _mm256_add_ps(near, _mm256_mul_ps(_mm256_sub_ps(far, near), fx));
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 target = _mm256_add_ps(ground, eye);
+        py = _mm256_add_ps(py, _mm256_mul_ps(_mm256_sub_ps(target, py), a));
+        _mm256_storeu_ps(y + i, py);
+    }
+    return i;
+}
+#endif
+
+inline bool cpuHasAvx2()
+{
+#ifdef FPV_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+inline void followGround(const HeightField& field, const float* x,
+                         const float* z, float* y, size_t count,
+                         float eyeHeight, float alpha)
+{
+    size_t done = 0;
+#ifdef FPV_X86
+    if (cpuHasAvx2())
+        done = followGroundAvx2(field, x, z, y, count, eyeHeight, alpha);
+#endif
+    followGroundScalar(field, x + done, z + done, y + done, count - done,
+                       eyeHeight, alpha);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free exchange between exactly two threads.
+
+// Latest-value handoff: the writer fills back() and publish()es it, the
+// reader calls acquire() and reads front(). Neither side ever waits; the
+// reader always gets the newest published value, older ones are skipped.
+template <typename T> class TripleBuffer
+{
+  public:
+    TripleBuffer() : middle(1) {}
+
+    // writer side
+    T& back() { return slots[backIndex]; }
+    void publish()
+    {
+        int old = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = old & INDEX;
+    }
+
+    // reader side: true when a newer value than the current front() arrived
+    bool acquire()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        frontIndex =
+            middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots[frontIndex]; }
+
+  private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    T slots[3];
+    int frontIndex = 0; // reader only
+    int backIndex = 2;  // writer only
+    std::atomic<int> middle;
+};
+
+// Bounded single-producer, single-consumer FIFO.
+template <typename T> class SpscQueue
+{
+  public:
+    explicit SpscQueue(size_t capacity = 1024)
+        : slots(roundUp(capacity)), mask(slots.size() - 1), head(0), tail(0)
+    {
+    }
+
+    // producer; false when full
+    bool push(const T& value)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size())
+            return false;
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer; false when empty
+    bool pop(T& value)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    std::vector<T> slots;
+    size_t mask;
+    std::atomic<size_t> head;
+    char pad[64];
+    std::atomic<size_t> tail;
+
+    static size_t roundUp(size_t n)
+    {
+        size_t size = 1;
+        while (size < n)
+            size <<= 1;
+        return size;
+    }
+};
+
+#endif
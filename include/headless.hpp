@@ -0,0 +1,172 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+#include "gl_ext.hpp"
+
+// Offscreen GL context for machines without a display (CI, benchmarks on
+// Mesa llvmpipe). Uses EGL on the surfaceless platform when available and a
+// pbuffer on the default display otherwise; either way everything is drawn
+// into an FBO of the requested size.
+class HeadlessContext
+{
+  public:
+    unsigned int framebuffer = 0;
+    int width = 0, height = 0;
+
+    HeadlessContext() {}
+    ~HeadlessContext() { destroy(); }
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    bool init(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+                "eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                         EGL_DEFAULT_DISPLAY, NULL);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            if (display == EGL_NO_DISPLAY ||
+                !eglInitialize(display, NULL, NULL))
+            {
+                std::cout << "Failed to initialize EGL" << std::endl;
+                return false;
+            }
+        }
+        eglBindAPI(EGL_OPENGL_API);
+
+        const EGLint configAttribs[] = {EGL_SURFACE_TYPE,
+                                        EGL_PBUFFER_BIT,
+                                        EGL_RENDERABLE_TYPE,
+                                        EGL_OPENGL_BIT,
+                                        EGL_NONE};
+        EGLConfig config = NULL;
+        EGLint configCount = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+
+        const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                         3,
+                                         EGL_CONTEXT_MINOR_VERSION,
+                                         3,
+                                         EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                         EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                         EGL_NONE};
+        // surfaceless needs no config (EGL_KHR_no_config_context)
+        context = eglCreateContext(display,
+                                   configCount ? config : EGLConfig(NULL),
+                                   EGL_NO_CONTEXT, contextAttribs);
+        if (context == EGL_NO_CONTEXT)
+        {
+            std::cout << "Failed to create EGL context" << std::endl;
+            return false;
+        }
+
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            // no surfaceless support: fall back to a tiny pbuffer
+            const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1,
+                                             EGL_NONE};
+            if (configCount)
+                surface =
+                    eglCreatePbufferSurface(display, config, pbufferAttribs);
+            if (surface == EGL_NO_SURFACE ||
+                !eglMakeCurrent(display, surface, surface, context))
+            {
+                std::cout << "Failed to make EGL context current"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        loadGLExtensions((GLADloadproc)eglGetProcAddress);
+        std::cout << "headless: " << glGetString(GL_RENDERER) << ", "
+                  << glGetString(GL_VERSION) << std::endl;
+
+        // render target
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                  GL_RENDERBUFFER, renderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width,
+                              height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                  GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+            GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+    }
+
+    // stands in for the swap: keeps at most `maxQueued` frames in flight so
+    // the CPU cannot run arbitrarily far ahead of the GPU
+    void present(unsigned int maxQueued = 2)
+    {
+        if (fences[cursor])
+        {
+            glClientWaitSync(fences[cursor], GL_SYNC_FLUSH_COMMANDS_BIT,
+                             GL_TIMEOUT_IGNORED);
+            glDeleteSync(fences[cursor]);
+        }
+        fences[cursor] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        cursor = (cursor + 1) % (maxQueued < MAX_QUEUED ? maxQueued
+                                                        : MAX_QUEUED);
+    }
+
+    void destroy()
+    {
+        if (context == EGL_NO_CONTEXT)
+            return;
+        for (unsigned int i = 0; i < MAX_QUEUED; ++i)
+            if (fences[i])
+                glDeleteSync(fences[i]);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        context = EGL_NO_CONTEXT;
+        surface = EGL_NO_SURFACE;
+        display = EGL_NO_DISPLAY;
+    }
+
+  private:
+    static const unsigned int MAX_QUEUED = 4;
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+    unsigned int renderbuffers[2] = {0, 0};
+    GLsync fences[MAX_QUEUED] = {0, 0, 0, 0};
+    unsigned int cursor = 0;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef HEIGHT_PYRAMID_H
+#define HEIGHT_PYRAMID_H
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "map.hpp"
+#include "raycast.hpp"
+
+// Min/max mip pyramid over the terrain column tops. Level 0 holds one texel
+// per block; every level above halves both sides, each texel keeping the
+// lowest and highest top of the (up to) 2x2 texels under it, until a single
+// texel covers the whole map.
+//
+// castRay() gives the same answer as the per-cell castRay() in raycast.hpp
+// but marches the pyramid: while the ray stays above a texel's highest top it
+// crosses the whole texel in one step and climbs a level, and only descends
+// where it could touch the ground. A ray already below a texel's lowest top
+// hits right where it is, at any level.
+class HeightPyramid
+{
+  public:
+    void build(const Map& map)
+    {
+        PROFILE_SCOPE("HeightPyramid::build");
+        levels.clear();
+        Level base;
+        base.width = map.width;
+        base.depth = map.depth;
+        base.lo = map.columnTop;
+        base.hi = map.columnTop;
+        levels.push_back(base);
+        while (levels.back().width > 1 || levels.back().depth > 1)
+        {
+            const Level& below = levels.back();
+            Level level;
+            level.width = (below.width + 1) / 2;
+            level.depth = (below.depth + 1) / 2;
+            level.lo.resize(level.width * level.depth);
+            level.hi.resize(level.width * level.depth);
+            levels.push_back(level);
+            for (int x = 0; x < level.width; ++x)
+                for (int z = 0; z < level.depth; ++z)
+                    refresh((int)levels.size() - 1, x, z);
+        }
+    }
+
+    // after the top of block (x, z) changed in `map`: one texel per level
+    void update(const Map& map, int x, int z)
+    {
+        if (levels.empty() || x < 0 || z < 0 || x >= levels[0].width ||
+            z >= levels[0].depth)
+            return;
+        int i = x * levels[0].depth + z;
+        levels[0].lo[i] = levels[0].hi[i] = map.columnTop[i];
+        for (int level = 1; level < (int)levels.size(); ++level)
+            refresh(level, x >> level, z >> level);
+    }
+
+    int levelCount() const { return (int)levels.size(); }
+    float minTop(int level, int x, int z) const
+    {
+        return levels[level].lo[x * levels[level].depth + z];
+    }
+    float maxTop(int level, int x, int z) const
+    {
+        return levels[level].hi[x * levels[level].depth + z];
+    }
+
+    RayHit castRay(const Ray& ray) const
+    {
+        RayHit result;
+        if (levels.empty())
+            return result;
+        const int width = levels[0].width, depth = levels[0].depth;
+        const glm::vec3 o = ray.origin, d = ray.direction;
+        int stepX = d.x > 0.0f ? 1 : -1, stepZ = d.z > 0.0f ? 1 : -1;
+
+        // only the part of the ray over the map can hit anything
+        float t = 0.0f, tEnd = ray.maxDistance;
+        glm::vec3 normal(0.0f);
+        if (!clip(o.x, d.x, width, t, tEnd, normal, 0, stepX) ||
+            !clip(o.z, d.z, depth, t, tEnd, normal, 2, stepZ))
+            return result;
+        int cx = std::min(std::max(Map::cellOf(o.x + d.x * t), 0), width - 1);
+        int cz = std::min(std::max(Map::cellOf(o.z + d.z * t), 0), depth - 1);
+
+        int level = (int)levels.size() - 1;
+        while (t <= tEnd)
+        {
+            const Level& texels = levels[level];
+            int nx = cx >> level, nz = cz >> level;
+            int i = nx * texels.depth + nz;
+            float y0 = o.y + d.y * t;
+            if (y0 <= texels.lo[i])
+                return hit(result, cx, cz, normal, t, ray); // through a side
+
+            // where the ray leaves this texel
+            float bx = (float)((stepX > 0 ? nx + 1 : nx) << level) - 0.5f;
+            float bz = (float)((stepZ > 0 ? nz + 1 : nz) << level) - 0.5f;
+            float tx = d.x != 0.0f ? (bx - o.x) / d.x : FLT_MAX;
+            float tz = d.z != 0.0f ? (bz - o.z) / d.z : FLT_MAX;
+            float exit = std::min(std::min(tx, tz), tEnd);
+            float y1 = o.y + d.y * exit;
+            if (std::min(y0, y1) <= texels.hi[i])
+            {
+                if (level > 0)
+                {
+                    --level;
+                    continue;
+                }
+                // a single block, entered above its top: down through it
+                return hit(result, cx, cz, glm::vec3(0.0f, 1.0f, 0.0f),
+                           (texels.hi[i] - o.y) / d.y, ray);
+            }
+
+            // clear of this texel: step into the next one and climb a level
+            if (exit >= tEnd)
+                break;
+            int first = 0, last = 0;
+            if (tx <= tz)
+            {
+                t = tx;
+                cx = stepX > 0 ? (nx + 1) << level : (nx << level) - 1;
+                first = nz << level;
+                last = ((nz + 1) << level) - 1;
+                cz = std::min(std::max(Map::cellOf(o.z + d.z * t), first),
+                              last);
+                normal = glm::vec3((float)-stepX, 0.0f, 0.0f);
+            }
+            else
+            {
+                t = tz;
+                cz = stepZ > 0 ? (nz + 1) << level : (nz << level) - 1;
+                first = nx << level;
+                last = ((nx + 1) << level) - 1;
+                cx = std::min(std::max(Map::cellOf(o.x + d.x * t), first),
+                              last);
+                normal = glm::vec3(0.0f, 0.0f, (float)-stepZ);
+            }
+            if (cx < 0 || cz < 0 || cx >= width || cz >= depth)
+                break;
+            if (level + 1 < (int)levels.size())
+                ++level;
+        }
+        return result;
+    }
+
+    // true when terrain lies between the two points, e.g. for shadow rays
+    bool occluded(const glm::vec3& from, const glm::vec3& to) const
+    {
+        return castRay(segmentRay(from, to)).hit;
+    }
+
+  private:
+    struct Level
+    {
+        int width = 0, depth = 0;
+        std::vector<float> lo, hi; // x * depth + z
+    };
+    std::vector<Level> levels;
+
+    void refresh(int level, int x, int z)
+    {
+        const Level& below = levels[level - 1];
+        Level& texels = levels[level];
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (int cx = 2 * x; cx <= 2 * x + 1 && cx < below.width; ++cx)
+            for (int cz = 2 * z; cz <= 2 * z + 1 && cz < below.depth; ++cz)
+            {
+                lo = std::min(lo, below.lo[cx * below.depth + cz]);
+                hi = std::max(hi, below.hi[cx * below.depth + cz]);
+            }
+        texels.lo[x * texels.depth + z] = lo;
+        texels.hi[x * texels.depth + z] = hi;
+    }
+
+    // narrows [t, tEnd] to where the ray is over the map along one axis of
+    // `size` blocks; entering through the edge sets the face normal
+    static bool clip(float o, float d, int size, float& t, float& tEnd,
+                     glm::vec3& normal, int axis, int step)
+    {
+        const float lo = -0.5f, hi = size - 0.5f;
+        if (d == 0.0f)
+            return o >= lo && o < hi;
+        float t0 = ((step > 0 ? lo : hi) - o) / d;
+        float t1 = ((step > 0 ? hi : lo) - o) / d;
+        if (t0 > t)
+        {
+            t = t0;
+            normal = glm::vec3(0.0f);
+            normal[axis] = (float)-step;
+        }
+        tEnd = std::min(tEnd, t1);
+        return t <= tEnd;
+    }
+
+    static RayHit hit(RayHit& result, int x, int z, const glm::vec3& normal,
+                      float distance, const Ray& ray)
+    {
+        result.hit = true;
+        result.x = x;
+        result.z = z;
+        result.normal = normal;
+        result.distance = distance;
+        result.point = ray.origin + ray.direction * distance;
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Log-linear ("HDR") histogram of durations in microseconds: 32 linear
+// sub-buckets per power of two, so any value is kept within about 3% and a
+// histogram covering 1 us to hours stays under 5 KB however many samples it
+// sees.
+class Histogram
+{
+  public:
+    static const unsigned int SUB_BITS = 5;
+    static const unsigned int SUB = 1u << SUB_BITS;
+    static const unsigned int MAX_BITS = 40; // about 12 days in us
+
+    void record(double ms)
+    {
+        uint64_t us = ms <= 0.0 ? 0 : (uint64_t)(ms * 1000.0 + 0.5);
+        recordUs(us);
+    }
+
+    void recordUs(uint64_t us, uint64_t times = 1)
+    {
+        if (us >> MAX_BITS)
+            us = (1ull << MAX_BITS) - 1;
+        unsigned int index = indexOf(us);
+        if (index >= counts.size())
+            counts.resize(index + 1, 0);
+        counts[index] += times;
+        if (total == 0 || us < minUs)
+            minUs = us;
+        if (us > maxUs)
+            maxUs = us;
+        total += times;
+        sumUs += us * times;
+    }
+
+    uint64_t count() const { return total; }
+    double min() const { return minUs / 1000.0; }
+    double max() const { return maxUs / 1000.0; }
+    double mean() const { return total ? sumUs / 1000.0 / total : 0.0; }
+
+    // p in [0, 100], as the midpoint of the bucket holding that rank
+    double percentile(double p) const
+    {
+        if (!total)
+            return 0.0;
+        uint64_t rank = (uint64_t)(p / 100.0 * (total - 1) + 0.5) + 1;
+        uint64_t seen = 0;
+        for (unsigned int i = 0; i < counts.size(); ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+                return midpoint(i) / 1000.0;
+        }
+        return max();
+    }
+
+    const std::vector<uint64_t>& buckets() const { return counts; }
+
+    static unsigned int indexOf(uint64_t us)
+    {
+        if (us < 2 * SUB)
+            return (unsigned int)us;
+        unsigned int bits = 0;
+        while ((us >> bits) >= 2 * SUB)
+            ++bits;
+        // us >> bits is in [SUB, 2 * SUB)
+        return 2 * SUB + (bits - 1) * SUB + (unsigned int)((us >> bits) - SUB);
+    }
+
+    static uint64_t lowerBound(unsigned int index)
+    {
+        if (index < 2 * SUB)
+            return index;
+        unsigned int bits = (index - 2 * SUB) / SUB + 1;
+        uint64_t mantissa = SUB + (index - 2 * SUB) % SUB;
+        return mantissa << bits;
+    }
+
+    static double midpoint(unsigned int index)
+    {
+        return (lowerBound(index) + lowerBound(index + 1) - 1) / 2.0;
+    }
+
+    // summary file form: "count min max sum index:count ..."
+    std::string serialize() const
+    {
+        std::ostringstream out;
+        out << total << ' ' << minUs << ' ' << maxUs << ' ' << sumUs;
+        for (unsigned int i = 0; i < counts.size(); ++i)
+            if (counts[i])
+                out << ' ' << i << ':' << counts[i];
+        return out.str();
+    }
+
+    bool deserialize(const std::string& text)
+    {
+        *this = Histogram();
+        std::istringstream in(text);
+        if (!(in >> total >> minUs >> maxUs >> sumUs))
+            return false;
+        std::string bucket;
+        while (in >> bucket)
+        {
+            unsigned int index;
+            unsigned long long n;
+            if (std::sscanf(bucket.c_str(), "%u:%llu", &index, &n) != 2 ||
+                index > indexOf((1ull << MAX_BITS) - 1))
+                return false;
+            if (index >= counts.size())
+                counts.resize(index + 1, 0);
+            counts[index] = n;
+        }
+        return true;
+    }
+
+  private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t minUs = 0, maxUs = 0, sumUs = 0;
+};
+
+// Named histograms for one run (frame time, CPU phases, GPU passes), written
+// as a small text file that perfcompare reads back.
+class PerfSummary
+{
+  public:
+    std::map<std::string, Histogram> zones;
+
+    void record(const std::string& zone, double ms) { zones[zone].record(ms); }
+
+    bool write(const char* path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "ERROR::SUMMARY::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        out << "fpv-summary 1\n";
+        for (std::map<std::string, Histogram>::const_iterator it =
+                 zones.begin();
+             it != zones.end(); ++it)
+            out << it->first << '\t' << it->second.serialize() << '\n';
+        std::cout << "summary: wrote " << zones.size() << " zones to " << path
+                  << std::endl;
+        return true;
+    }
+
+    bool read(const char* path)
+    {
+        zones.clear();
+        std::ifstream in(path);
+        std::string line;
+        if (!std::getline(in, line) || line != "fpv-summary 1")
+        {
+            std::cout << "ERROR::SUMMARY::NOT_A_SUMMARY: " << path << std::endl;
+            return false;
+        }
+        while (std::getline(in, line))
+        {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos ||
+                !zones[line.substr(0, tab)].deserialize(line.substr(tab + 1)))
+            {
+                std::cout << "ERROR::SUMMARY::BAD_LINE: " << line << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Mann-Whitney U test between two histograms, treating every bucket as one
+// group of ties. z > 0 means the candidate tends to be slower.
+struct Comparison
+{
+    double baseMedian = 0.0, candidateMedian = 0.0; // ms
+    double change = 0.0;                            // relative, 0.05 = +5%
+    double z = 0.0;
+    double p = 1.0; // two-sided
+};
+
+inline Comparison compareHistograms(const Histogram& base,
+                                    const Histogram& candidate)
+{
+    Comparison result;
+    result.baseMedian = base.percentile(50);
+    result.candidateMedian = candidate.percentile(50);
+    if (result.baseMedian > 0.0)
+        result.change = result.candidateMedian / result.baseMedian - 1.0;
+
+    double na = (double)base.count(), nb = (double)candidate.count();
+    if (na == 0 || nb == 0)
+        return result;
+    const std::vector<uint64_t>& a = base.buckets();
+    const std::vector<uint64_t>& b = candidate.buckets();
+    size_t size = a.size() > b.size() ? a.size() : b.size();
+    double rankBelow = 0.0, rankSumB = 0.0, ties = 0.0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        double ca = i < a.size() ? (double)a[i] : 0.0;
+        double cb = i < b.size() ? (double)b[i] : 0.0;
+        double t = ca + cb;
+        if (t == 0)
+            continue;
+        rankSumB += cb * (rankBelow + (t + 1.0) / 2.0);
+        ties += t * t * t - t;
+        rankBelow += t;
+    }
+    double n = na + nb;
+    double u = rankSumB - nb * (nb + 1.0) / 2.0;
+    double mean = na * nb / 2.0;
+    double variance = na * nb / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+    if (variance <= 0.0)
+        return result;
+    result.z = (u - mean) / std::sqrt(variance);
+    result.p = std::erfc(std::fabs(result.z) / std::sqrt(2.0));
+    return result;
+}
+
+#endif
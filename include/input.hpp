@@ -0,0 +1,289 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "timestep.hpp"
+
+enum InputEventType
+{
+    INPUT_KEY = 0,
+    INPUT_MOUSE_MOVE = 1,
+    INPUT_SCROLL = 2
+};
+
+// One input event as the simulation sees it. Key events carry the GLFW key
+// code and whether it went down; mouse and scroll events carry offsets, so a
+// replay does not depend on where the cursor was.
+struct InputEvent
+{
+    uint8_t type;
+    uint8_t pressed;
+    int16_t key;
+    float x, y;
+    float time; // seconds since the start of the run
+};
+static_assert(sizeof(InputEvent) == 16, "InputEvent is written as is");
+
+inline InputEvent makeInputEvent(InputEventType type, float time, int key = 0,
+                                 bool pressed = false, float x = 0.0f,
+                                 float y = 0.0f)
+{
+    InputEvent event;
+    event.type = (uint8_t)type;
+    event.pressed = pressed ? 1 : 0;
+    event.key = (int16_t)key;
+    event.x = x;
+    event.y = y;
+    event.time = time;
+    return event;
+}
+
+// Events waiting for the simulation, oldest first. Each tick takes the ones
+// stamped up to the moment it ends, so an event lands in the tick it
+// happened in rather than wherever the frame boundary fell.
+class InputQueue
+{
+  public:
+    // in time order, as GLFW and a replay deliver them
+    void push(const InputEvent& event) { events.push_back(event); }
+    void push(const std::vector<InputEvent>& batch)
+    {
+        events.insert(events.end(), batch.begin(), batch.end());
+    }
+
+    // the events up to `time`, replacing what `out` held
+    void take(float time, std::vector<InputEvent>& out)
+    {
+        out.clear();
+        while (!events.empty() && events.front().time <= time)
+        {
+            out.push_back(events.front());
+            events.pop_front();
+        }
+    }
+
+    size_t size() const { return events.size(); }
+
+  private:
+    std::deque<InputEvent> events;
+};
+
+// Input for a simulation on a fixed timestep, fed one frame at a time. The
+// input clock only moves by the deltas given to frame(), which the timestep
+// gets as well: the measured ones live, the recorded ones on a replay. Wall
+// time never enters, so a replay puts every event into the tick it was
+// recorded in however fast it is played back.
+class TickInput
+{
+  public:
+    // `clock` is where the clock starts, in the time of the events
+    explicit TickInput(double clock = 0.0) : clockSeconds(clock) {}
+
+    void push(const InputEvent& event) { queue.push(event); }
+
+    // moves the clock and `timestep` on by one frame, then calls
+    // tick(events) for each tick that came due, with the events stamped up
+    // to the moment that tick ends; returns the number of ticks
+    template <typename F>
+    int frame(double deltaTime, FixedTimestep& timestep, const F& tick)
+    {
+        if (deltaTime > 0.0)
+            clockSeconds += deltaTime;
+        int ticks = timestep.advance(deltaTime);
+        const double step = timestep.step();
+        for (int i = 0; i < ticks; ++i)
+        {
+            // the last tick ends a leftover alpha before the clock
+            double end =
+                clockSeconds - (timestep.alpha() + (ticks - 1 - i)) * step;
+            queue.take((float)end, events);
+            tick(events);
+        }
+        return ticks;
+    }
+
+    double clock() const { return clockSeconds; }
+    size_t pending() const { return queue.size(); }
+
+  private:
+    InputQueue queue;
+    // double: summed in float it drifts off the event times within an hour
+    double clockSeconds = 0.0;
+    std::vector<InputEvent> events;
+};
+
+// Mouse look the simulation has been sent but has not applied yet, or not in
+// the snapshot being drawn. Adding it on top of the simulated camera puts a
+// mouse move on screen in the next frame drawn, whichever tick consumes it.
+// Events are numbered in the order they are sent, and the simulation reports
+// how many it has applied.
+class LookLatch
+{
+  public:
+    void sent(const InputEvent& event)
+    {
+        ++sentCount;
+        if (event.type == INPUT_MOUSE_MOVE)
+        {
+            Look look = {sentCount, event.x, event.y};
+            pending.push_back(look);
+        }
+    }
+
+    // the first `count` events sent have been applied
+    void applied(unsigned long count)
+    {
+        while (!pending.empty() && pending.front().sequence <= count)
+            pending.pop_front();
+    }
+
+    // move(x, y) for each offset not applied yet, oldest first
+    template <typename F> void forEachPending(const F& move) const
+    {
+        for (const Look& look : pending)
+            move(look.x, look.y);
+    }
+
+    size_t pendingCount() const { return pending.size(); }
+
+  private:
+    struct Look
+    {
+        unsigned long sequence;
+        float x, y;
+    };
+    std::deque<Look> pending;
+    unsigned long sentCount = 0;
+};
+
+// Recording format: "FPVI", u32 version, then per frame the f32 frame delta,
+// a u32 event count and the events. Little endian, as written by the host.
+static const char INPUT_FILE_MAGIC[4] = {'F', 'P', 'V', 'I'};
+static const uint32_t INPUT_FILE_VERSION = 1;
+
+class InputRecorder
+{
+  public:
+    InputRecorder() {}
+    ~InputRecorder() { close(); }
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    bool open(const char* path)
+    {
+        close();
+        file = std::fopen(path, "wb");
+        if (!file)
+        {
+            std::cout << "ERROR::INPUT::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        std::fwrite(INPUT_FILE_MAGIC, 1, 4, file);
+        std::fwrite(&INPUT_FILE_VERSION, sizeof(uint32_t), 1, file);
+        frames = 0;
+        return true;
+    }
+
+    bool isOpen() const { return file != NULL; }
+
+    void writeFrame(float deltaTime, const std::vector<InputEvent>& events)
+    {
+        if (!file)
+            return;
+        uint32_t count = (uint32_t)events.size();
+        std::fwrite(&deltaTime, sizeof(float), 1, file);
+        std::fwrite(&count, sizeof(uint32_t), 1, file);
+        if (count)
+            std::fwrite(&events[0], sizeof(InputEvent), count, file);
+        ++frames;
+    }
+
+    void close()
+    {
+        if (!file)
+            return;
+        std::fclose(file);
+        file = NULL;
+        std::cout << "input: recorded " << frames << " frames" << std::endl;
+    }
+
+  private:
+    FILE* file = NULL;
+    unsigned long frames = 0;
+};
+
+class InputReplayer
+{
+  public:
+    InputReplayer() {}
+    ~InputReplayer() { close(); }
+    InputReplayer(const InputReplayer&) = delete;
+    InputReplayer& operator=(const InputReplayer&) = delete;
+
+    bool open(const char* path)
+    {
+        close();
+        file = std::fopen(path, "rb");
+        char magic[4];
+        uint32_t version = 0;
+        if (!file || std::fread(magic, 1, 4, file) != 4 ||
+            std::memcmp(magic, INPUT_FILE_MAGIC, 4) != 0 ||
+            std::fread(&version, sizeof(uint32_t), 1, file) != 1 ||
+            version != INPUT_FILE_VERSION)
+        {
+            std::cout << "ERROR::INPUT::NOT_A_RECORDING: " << path
+                      << std::endl;
+            close();
+            return false;
+        }
+        // count the frames up front so a replay has a known length
+        frames = 0;
+        long start = std::ftell(file);
+        float deltaTime;
+        uint32_t count;
+        while (std::fread(&deltaTime, sizeof(float), 1, file) == 1 &&
+               std::fread(&count, sizeof(uint32_t), 1, file) == 1 &&
+               std::fseek(file, (long)(count * sizeof(InputEvent)),
+                          SEEK_CUR) == 0)
+            ++frames;
+        std::fseek(file, start, SEEK_SET);
+        return true;
+    }
+
+    bool isOpen() const { return file != NULL; }
+    unsigned long frameCount() const { return frames; }
+
+    // false once the recording is exhausted
+    bool readFrame(float& deltaTime, std::vector<InputEvent>& events)
+    {
+        events.clear();
+        uint32_t count = 0;
+        if (!file || std::fread(&deltaTime, sizeof(float), 1, file) != 1 ||
+            std::fread(&count, sizeof(uint32_t), 1, file) != 1)
+            return false;
+        events.resize(count);
+        if (count && std::fread(&events[0], sizeof(InputEvent), count,
+                                file) != count)
+            return false;
+        return true;
+    }
+
+    void close()
+    {
+        if (file)
+            std::fclose(file);
+        file = NULL;
+    }
+
+  private:
+    FILE* file = NULL;
+    unsigned long frames = 0;
+};
+
+#endif
@@ -0,0 +1,425 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+
+class JobCounter;
+
+struct Job
+{
+    std::function<void()> fn;
+    JobCounter* counter;
+};
+
+// Counts scheduled jobs that have not finished yet. Jobs can also be parked
+// on a counter and start once it drops to zero, which is how dependencies
+// are expressed:
+//
+//   JobCounter terrain, meshes;
+//   jobs.schedule(generate, &terrain);
+//   jobs.schedule(mesh, &meshes, &terrain); // runs after generate
+//   jobs.wait(meshes);
+class JobCounter
+{
+  public:
+    JobCounter() : pending(0) {}
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+    std::atomic<int> pending;
+    std::mutex mutex;
+    std::vector<Job*> waiting;
+    bool released = false; // the last job took `waiting`; under `mutex`
+};
+
+// Chase-Lev work-stealing deque (the fixed-size variant from Le et al.,
+// "Correct and Efficient Work-Stealing for Weak Memory Models"). The owning
+// thread pushes and pops at the bottom, any thread may steal from the top.
+class WorkStealingDeque
+{
+  public:
+    static const int64_t CAPACITY = 4096;
+
+    WorkStealingDeque() : top(0), bottom(0) {}
+
+    // owner only; false when full
+    bool push(Job* job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+            return false;
+        buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // owner only
+    Job* pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return NULL;
+        }
+        Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // last job: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed))
+                job = NULL;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // any thread
+    Job* steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return NULL;
+        Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+            return NULL;
+        return job;
+    }
+
+  private:
+    // top and bottom on separate cache lines: thieves hammer one, the owner
+    // the other
+    std::atomic<int64_t> top;
+    char padTop[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom;
+    char padBottom[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<Job*> buffer[CAPACITY];
+};
+
+// Work-stealing job system. The thread calling start() becomes thread 0 and
+// takes part in the work whenever it waits on a counter; the workers are
+// threads 1..N. Jobs scheduled from any other thread go through a shared
+// queue. Until start() is called, schedule() runs jobs inline, so code built
+// on it also works in tools and tests that never start the workers.
+class JobSystem
+{
+  public:
+    JobSystem() {}
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem() { stop(); }
+
+    static unsigned int defaultWorkerCount()
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 1;
+    }
+
+    void start(unsigned int workerCount = defaultWorkerCount())
+    {
+        if (running())
+            return;
+        quit = false;
+        for (unsigned int i = 0; i <= workerCount; ++i)
+            queues.push_back(new WorkStealingDeque());
+        executed = std::vector<std::atomic<unsigned long>>(queues.size());
+        local().system = this;
+        local().index = 0;
+        for (unsigned int i = 1; i <= workerCount; ++i)
+            workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+    }
+
+    // the caller must have waited for everything it scheduled
+    void stop()
+    {
+        if (!running())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (unsigned int i = 0; i < workers.size(); ++i)
+            workers[i].join();
+        workers.clear();
+        for (unsigned int i = 0; i < queues.size(); ++i)
+            delete queues[i];
+        queues.clear();
+        if (local().system == this)
+            local().system = NULL;
+    }
+
+    bool running() const { return !queues.empty(); }
+    unsigned int workerCount() const { return (unsigned int)workers.size(); }
+
+    // 0 for the thread that called start(), 1..N for workers, -1 otherwise
+    int currentThread() const
+    {
+        return local().system == this ? local().index : -1;
+    }
+
+    // `counter` (optional) is bumped now and dropped when the job finished;
+    // with `after`, the job only starts once that counter reached zero
+    void schedule(std::function<void()> fn, JobCounter* counter = NULL,
+                  JobCounter* after = NULL)
+    {
+        Job* job = new Job;
+        job->fn = std::move(fn);
+        job->counter = counter;
+        if (counter)
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            counter->released = false;
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (after)
+        {
+            std::lock_guard<std::mutex> lock(after->mutex);
+            if (!after->done() && !after->released)
+            {
+                after->waiting.push_back(job);
+                return;
+            }
+        }
+        enqueue(job);
+    }
+
+    // runs other jobs until the counter drops to zero
+    void wait(JobCounter& counter)
+    {
+        while (!counter.done())
+            if (!runOne())
+                std::this_thread::yield();
+    }
+
+    // runs one queued job on the calling thread; false if none was found
+    bool runOne()
+    {
+        Job* job = take(currentThread());
+        if (!job)
+            return false;
+        execute(job, currentThread());
+        return true;
+    }
+
+    // calls fn(begin, end) over [0, count) split into chunks of at least
+    // `minChunk` items, a few per thread so stealing can even out the load;
+    // returns when every chunk is done
+    template <typename F>
+    void parallelFor(size_t count, size_t minChunk, const F& fn)
+    {
+        if (minChunk == 0)
+            minChunk = 1;
+        if (!running() || count <= minChunk)
+        {
+            if (count)
+                fn((size_t)0, count);
+            return;
+        }
+        size_t chunks = count / minChunk;
+        size_t maxChunks = queues.size() * 4;
+        if (chunks > maxChunks)
+            chunks = maxChunks;
+        size_t size = (count + chunks - 1) / chunks;
+        JobCounter counter;
+        for (size_t begin = size; begin < count; begin += size)
+        {
+            size_t end = begin + size < count ? begin + size : count;
+            schedule([&fn, begin, end]() { fn(begin, end); }, &counter);
+        }
+        fn((size_t)0, size);
+        wait(counter);
+    }
+
+    // jobs each thread ran and how many were stolen
+    void print(std::ostream& out) const
+    {
+        if (!running())
+            return;
+        unsigned long total = 0;
+        for (unsigned int i = 0; i < executed.size(); ++i)
+            total += executed[i].load();
+        if (total == 0)
+            return;
+        out << "jobs: " << total << " on " << queues.size()
+            << " thread(s), " << steals.load() << " stolen, per thread";
+        for (unsigned int i = 0; i < executed.size(); ++i)
+            out << ' ' << executed[i].load();
+        out << std::endl;
+    }
+
+  private:
+    struct Local
+    {
+        JobSystem* system;
+        int index;
+    };
+
+    std::vector<WorkStealingDeque*> queues;
+    std::vector<std::thread> workers;
+    std::vector<std::atomic<unsigned long>> executed;
+    std::atomic<unsigned long> steals{0};
+
+    // jobs from threads without a deque, and overflow of full deques
+    std::mutex sharedMutex;
+    std::deque<Job*> shared;
+
+    // idle workers sleep until `queued` says there is something to take
+    std::atomic<int> queued{0};
+    std::atomic<int> sleeping{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool quit = false;
+
+    static Local& local()
+    {
+        thread_local Local current = {NULL, -1};
+        return current;
+    }
+
+    void enqueue(Job* job)
+    {
+        if (!running())
+        {
+            execute(job, -1);
+            return;
+        }
+        int thread = currentThread();
+        if (thread < 0 || !queues[thread]->push(job))
+        {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            shared.push_back(job);
+        }
+        queued.fetch_add(1);
+        // pairs with the sleeping/queued check in workerLoop: either the
+        // worker sees the job or this thread sees the sleeper
+        if (sleeping.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    Job* take(int thread)
+    {
+        Job* job = NULL;
+        if (thread >= 0)
+            job = queues[thread]->pop();
+        if (!job)
+        {
+            // steal, starting from a different victim each time
+            thread_local unsigned int seed = 0x9e3779b9u;
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            unsigned int n = (unsigned int)queues.size();
+            for (unsigned int i = 0; i < n && !job; ++i)
+            {
+                unsigned int victim = (seed + i) % n;
+                if ((int)victim != thread)
+                    job = queues[victim]->steal();
+            }
+            if (job)
+                steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!job)
+        {
+            std::lock_guard<std::mutex> lock(sharedMutex);
+            if (!shared.empty())
+            {
+                job = shared.front();
+                shared.pop_front();
+            }
+        }
+        if (job)
+            queued.fetch_sub(1);
+        return job;
+    }
+
+    void execute(Job* job, int thread)
+    {
+        job->fn();
+        if (thread >= 0)
+            executed[thread].fetch_add(1, std::memory_order_relaxed);
+        JobCounter* counter = job->counter;
+        delete job;
+        if (!counter)
+            return;
+        // Whoever waits may free the counter the moment it reads zero, so
+        // the drop to zero has to be the last thing done to it. The last job
+        // takes the parked jobs under the lock and only then decrements; the
+        // others decrement under the lock, where the count cannot reach zero
+        // since the last job still needs that lock.
+        std::vector<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if (counter->pending.load(std::memory_order_relaxed) > 1)
+            {
+                counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+                return;
+            }
+            ready.swap(counter->waiting);
+            counter->released = true;
+        }
+        counter->pending.fetch_sub(1, std::memory_order_release);
+        for (unsigned int i = 0; i < ready.size(); ++i)
+            enqueue(ready[i]);
+    }
+
+    void workerLoop(int index)
+    {
+        PROFILE_THREAD_NAME("job worker " + std::to_string(index));
+        local().system = this;
+        local().index = index;
+        for (;;)
+        {
+            Job* job = take(index);
+            if (job)
+            {
+                execute(job, index);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleeping.fetch_add(1);
+            while (queued.load() <= 0 && !quit)
+                wake.wait(lock);
+            sleeping.fetch_sub(1);
+            if (quit)
+                break;
+        }
+        local().system = NULL;
+    }
+};
+
+// the engine-wide job system, started in main()
+inline JobSystem& jobSystem()
+{
+    static JobSystem jobs;
+    return jobs;
+}
+
+#endif
@@ -6,64 +6,173 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "arena.hpp"
 #include "block.hpp"
 #include "FastNoiseLite.h"
+#include "frustum.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
 #include "shader.hpp"
 
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <vector>
 class Map
 {
   public:
     std::vector<Block> map;
     std::vector<std::vector<float>> heightMap;
+    // top face of every block, x * depth + z, for collision
+    std::vector<float> columnTop;
     int width, depth;
 
-    Map(int width, int depth) : width(width), depth(depth)
+    // per-block floor transforms, built once instead of every frame
+    std::vector<glm::mat4> floorTransforms;
+    // result of the last cullFloor(): the visible blocks, in the frame arena
+    // of the thread that culled, so only good during that frame
+    const uint32_t* floorDrawList = NULL;
+    unsigned int floorDrawCount = 0;
+    unsigned long floorDrawFrame = 0;
+
+    Map() : width(0), depth(0) {}
+    Map(int width, int depth)
+    {
+        generate(width, depth);
+        buildFloorTransforms();
+    }
+
+    // terrain noise only; safe to run off the GL thread
+    void generate(int width, int depth)
     {
+        this->width = width;
+        this->depth = depth;
         heightMap = std::vector<std::vector<float>>(
             width + 1, std::vector<float>(depth + 1));
+        columnTop.assign(width * depth, 0.0f);
         map = generateTerrain(width, depth);
     }
+
+    // Block (x, z) fills the column [x - 0.5, x + 0.5) x [z - 0.5, z + 0.5)
+    // from below up to solidTop(); outside the map is a wall no one climbs.
+    static int cellOf(float coordinate)
+    {
+        return (int)std::floor(coordinate + 0.5f);
+    }
+    float solidTop(int x, int z) const
+    {
+        if (x < 0 || z < 0 || x >= width || z >= depth)
+            return 1e9f;
+        return columnTop[x * depth + z];
+    }
+
+    // meshing step for the floor pass: one translation per block
+    void buildFloorTransforms()
+    {
+        floorTransforms.resize(map.size());
+        auto build = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                floorTransforms[i] =
+                    glm::translate(glm::mat4(1.0f), map[i].pos);
+        };
+        jobSystem().parallelFor(map.size(), 1024, build);
+    }
+
+    // frustum test of every floor cube, split across the job system, into
+    // a draw list for createFloor() this frame; returns the number of
+    // visible cubes
+    unsigned int cullFloor(const glm::mat4& viewProjection)
+    {
+        PROFILE_SCOPE("Map::cullFloor");
+        const Frustum frustum(viewProjection);
+        // the jobs write into this thread's arena, which only it resets
+        FrameArena& arena = frameArena();
+        unsigned char* inside = arena.allocateArray<unsigned char>(map.size());
+        floorDrawList = NULL;
+        floorDrawCount = 0;
+        if (inside == NULL)
+            return 0;
+        std::atomic<unsigned int> visible(0);
+        auto cull = [&](size_t begin, size_t end) {
+            unsigned int count = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                inside[i] =
+                    frustum.intersects(map[i].pos - 0.5f, map[i].pos + 0.5f);
+                count += inside[i];
+            }
+            visible += count;
+        };
+        jobSystem().parallelFor(map.size(), 1024, cull);
+
+        uint32_t* list = arena.allocateArray<uint32_t>(visible);
+        if (list == NULL)
+            return 0;
+        unsigned int n = 0;
+        for (size_t i = 0; i < map.size(); ++i)
+            if (inside[i])
+                list[n++] = (uint32_t)i;
+        floorDrawList = list;
+        floorDrawCount = n;
+        floorDrawFrame = FrameArenas::instance().frame();
+        return n;
+    }
     std::vector<Block> generateTerrain(int width, int depth, float scale = 0.5f,
                                        float heightScale = 10.0f)
     {
+        PROFILE_SCOPE("Map::generateTerrain");
         FastNoiseLite noise;
         noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
         noise.SetFrequency(0.1f);
         noise.SetSeed(1337);
 
-        std::vector<Block> map;
-        for (int x = 0; x < width; ++x)
-        {
-            for (int z = 0; z < depth; ++z)
+        // columns are independent, block x * depth + z as before
+        std::vector<Block> map(width * depth);
+        auto columns = [&](size_t begin, size_t end) {
+            for (int x = (int)begin; x < (int)end; ++x)
             {
-                // Use Perlin Noise to get the height
-                float noiseValue =
-                    noise.GetNoise(static_cast<float>(x) * scale,
-                                   static_cast<float>(z) * scale);
+                for (int z = 0; z < depth; ++z)
+                {
+                    // Use Perlin Noise to get the height
+                    float noiseValue =
+                        noise.GetNoise(static_cast<float>(x) * scale,
+                                       static_cast<float>(z) * scale);
 
-                float height = (noiseValue + 1.0f) * 0.5f * heightScale;
-                map.emplace_back(static_cast<float>(x), height,
-                                 static_cast<float>(z));
+                    float height = (noiseValue + 1.0f) * 0.5f * heightScale;
+                    map[x * depth + z] =
+                        Block(static_cast<float>(x), height,
+                              static_cast<float>(z));
 
-                float topHeight = height + 1.0f;
-                heightMap[x][z] = topHeight;
+                    float topHeight = height + 1.0f;
+                    heightMap[x][z] = topHeight;
+                    columnTop[x * depth + z] = height + 0.5f;
+                }
             }
-        }
+        };
+        jobSystem().parallelFor(width, 8, columns);
         return map;
     }
 
-    void createFloor(const Shader& floorShader)
+    // returns the number of cubes drawn; with `culled`, only the ones
+    // cullFloor() found visible this frame (all of them without a cull)
+    unsigned int createFloor(const Shader& floorShader, bool culled = false)
     {
-        for (unsigned int i = 0; i < map.size(); ++i)
-        {
-            glm::mat4 model = glm::mat4(1.0f);
+        PROFILE_SCOPE("Map::createFloor");
+        if (floorTransforms.size() != map.size())
+            buildFloorTransforms();
+        if (floorDrawList == NULL ||
+            floorDrawFrame != FrameArenas::instance().frame())
+            culled = false;
 
-            floorShader.setMat4("model", model);
-            glm::mat4 trans = glm::mat4(1.0f);
-            trans = glm::translate(trans, map[i].pos);
-            floorShader.setMat4("trans", trans);
+        glm::mat4 model = glm::mat4(1.0f);
+        floorShader.setMat4("model", model);
+        unsigned int count = culled ? floorDrawCount : (unsigned int)map.size();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            unsigned int block = culled ? floorDrawList[i] : i;
+            floorShader.setMat4("trans", floorTransforms[block]);
             glDrawArrays(GL_TRIANGLES, 0, 36);
         }
+        return count;
     }
 };
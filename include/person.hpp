@@ -1,5 +1,6 @@
 #include "camera.hpp"
 #include "block.hpp"
+#include "physics.hpp"
 
 #include <vector>
 #include "glm/glm.hpp"
@@ -13,6 +14,7 @@ class Person
     glm::vec3 position;
     Block standing_object;
     float eyeHeight;
+    Body body; // feet on the ground, eyeHeight below the camera
 
     Person(Camera camera, glm::vec3 position) : camera(camera), eyeHeight(3.0)
     {
@@ -24,6 +26,24 @@ class Person
         camera.ProcessKeyboard(direction, deltaTime);
     }
 
+    // One physics step: walk towards `wish` (x right, y forward, as held on
+    // the keys) at MovementSpeed on the ground plane, fall and collide with
+    // the terrain, then put the eye on top of the body. The camera position
+    // stays the authority, so teleporting it moves the body along.
+    void Move(glm::vec2 wish, float deltaTime, const Map& map)
+    {
+        glm::vec3 forward(camera.Front.x, 0.0f, camera.Front.z);
+        glm::vec3 walk = wish.y * forward + wish.x * camera.Right;
+        walk.y = 0.0f;
+        if (glm::dot(walk, walk) > 0.0f)
+            walk = glm::normalize(walk) * camera.MovementSpeed;
+        body.position = camera.Position - glm::vec3(0.0f, eyeHeight, 0.0f);
+        body.velocity.x = walk.x;
+        body.velocity.z = walk.z;
+        stepBody(body, map, deltaTime);
+        camera.Position = body.position + glm::vec3(0.0f, eyeHeight, 0.0f);
+    }
+
     float heightCheckInterval = 0.1f; // check per 0.1s
     float lastHeightCheckTime = 0.0f;
     float smoothingFactor = 10.0f;
@@ -0,0 +1,138 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <algorithm>
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+#include "map.hpp"
+
+// An axis-aligned box standing on the terrain: `position` is the middle of
+// its bottom face.
+struct Body
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 velocity = glm::vec3(0.0f);
+    float halfWidth = 0.3f;
+    float height = 3.2f;
+    bool grounded = false;
+};
+
+struct PhysicsSettings
+{
+    float gravity = 20.0f;      // units/s^2, downwards
+    float maxFallSpeed = 50.0f; // units/s
+    float stepHeight = 1.0f;    // ledges a grounded body walks up (and down)
+};
+
+// Swept collision of bodies against the terrain columns, resolved one axis at
+// a time. Each horizontal move walks the cells along its axis in order, from
+// the one the leading face is in to the one it would end in, and stops at the
+// first column that is too high: a one-dimensional DDA over the grid, so a
+// fast body cannot skip a wall however far it moves in one step, and the cost
+// only grows with the number of cells crossed.
+namespace physics
+{
+
+// gap kept between a blocked box and the face it stopped at
+const float SKIN = 1e-3f;
+
+// highest column top under the footprint [x0, x1] x [z0, z1]
+inline float groundUnder(const Map& map, float x0, float x1, float z0,
+                         float z1)
+{
+    float top = -FLT_MAX;
+    int cx1 = Map::cellOf(x1), cz1 = Map::cellOf(z1);
+    for (int cx = Map::cellOf(x0); cx <= cx1; ++cx)
+        for (int cz = Map::cellOf(z0); cz <= cz1; ++cz)
+            top = std::max(top, map.solidTop(cx, cz));
+    return top;
+}
+
+// how far of `distance` along x (axis 0) or z (axis 2) the body can move
+// before a column higher than `floorY` is in the way
+inline float sweepAxis(const Map& map, const Body& body, int axis,
+                       float distance, float floorY)
+{
+    if (distance == 0.0f)
+        return 0.0f;
+    int other = axis == 0 ? 2 : 0;
+    int o0 = Map::cellOf(body.position[other] - body.halfWidth);
+    int o1 = Map::cellOf(body.position[other] + body.halfWidth);
+    int dir = distance > 0.0f ? 1 : -1;
+    float leading = body.position[axis] + dir * body.halfWidth;
+    int last = Map::cellOf(leading + distance);
+    for (int c = Map::cellOf(leading) + dir; c * dir <= last * dir; c += dir)
+    {
+        for (int o = o0; o <= o1; ++o)
+        {
+            float top = axis == 0 ? map.solidTop(c, o) : map.solidTop(o, c);
+            if (top <= floorY)
+                continue;
+            // stop just short of the face of cell c that faces us
+            float allowed = c - dir * (0.5f + SKIN) - leading;
+            return dir > 0 ? std::max(0.0f, allowed) : std::min(0.0f, allowed);
+        }
+    }
+    return distance;
+}
+
+inline float groundUnder(const Map& map, const Body& body)
+{
+    return groundUnder(map, body.position.x - body.halfWidth,
+                       body.position.x + body.halfWidth,
+                       body.position.z - body.halfWidth,
+                       body.position.z + body.halfWidth);
+}
+
+// after a horizontal move: climb onto a ledge that was let through, or follow
+// the ground down a step the body walked off
+inline void settle(const Map& map, Body& body, float stepHeight)
+{
+    float ground = groundUnder(map, body);
+    if (ground > body.position.y ||
+        (body.grounded && ground >= body.position.y - stepHeight))
+        body.position.y = ground;
+    body.grounded = body.position.y <= ground;
+}
+
+} // namespace physics
+
+// one step of `dt` seconds: gravity, then the body moves by its velocity,
+// vertical first, then x, then z
+inline void stepBody(Body& body, const Map& map, float dt,
+                     const PhysicsSettings& settings = PhysicsSettings())
+{
+    body.velocity.y = std::max(body.velocity.y - settings.gravity * dt,
+                               -settings.maxFallSpeed);
+
+    // vertical: the terrain is a height field, so only falling can hit it
+    float ground = physics::groundUnder(map, body);
+    body.position.y += body.velocity.y * dt;
+    body.grounded = false;
+    if (body.position.y <= ground)
+    {
+        body.position.y = ground;
+        body.velocity.y = 0.0f;
+        body.grounded = true;
+    }
+
+    // horizontal: a grounded body steps over anything up to stepHeight
+    float climb = body.grounded ? settings.stepHeight : 0.0f;
+    const int axes[2] = {0, 2};
+    for (int axis : axes)
+    {
+        float wanted = body.velocity[axis] * dt;
+        float moved = physics::sweepAxis(map, body, axis, wanted,
+                                         body.position.y + climb);
+        body.position[axis] += moved;
+        if (moved != wanted)
+            body.velocity[axis] = 0.0f;
+        physics::settle(map, body, settings.stepHeight);
+    }
+    if (body.grounded)
+        body.velocity.y = std::max(body.velocity.y, 0.0f);
+}
+
+#endif
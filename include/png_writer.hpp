@@ -0,0 +1,123 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <cstdio>
+#include <vector>
+
+// Minimal PNG encoder for screenshots: 8-bit RGB/RGBA, no filtering and
+// deflate "stored" blocks, so it needs no zlib. Files are about the size of
+// the raw pixels, which is fine for captures that are mostly post-processed
+// anyway.
+namespace png
+{
+
+struct CrcTable
+{
+    unsigned int entries[256];
+    CrcTable()
+    {
+        for (unsigned int n = 0; n < 256; ++n)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+    }
+};
+
+inline unsigned int crc32(const unsigned char* data, size_t size,
+                          unsigned int crc = 0xFFFFFFFFu)
+{
+    static const CrcTable table;
+    for (size_t i = 0; i < size; ++i)
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+inline void putU32(std::vector<unsigned char>& out, unsigned int v)
+{
+    out.push_back((v >> 24) & 0xFF);
+    out.push_back((v >> 16) & 0xFF);
+    out.push_back((v >> 8) & 0xFF);
+    out.push_back(v & 0xFF);
+}
+
+inline void putChunk(std::vector<unsigned char>& out, const char* type,
+                     const std::vector<unsigned char>& data)
+{
+    putU32(out, (unsigned int)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putU32(out, crc32(&out[start], out.size() - start) ^ 0xFFFFFFFFu);
+}
+
+// rows are top to bottom, `channels` is 3 (RGB) or 4 (RGBA)
+inline bool write(const char* path, int width, int height, int channels,
+                  const unsigned char* pixels)
+{
+    // scanlines with a leading filter byte (0 = none)
+    size_t stride = (size_t)width * channels;
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = 0; y < height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels + y * stride, pixels + (y + 1) * stride);
+    }
+
+    // zlib stream made of stored deflate blocks
+    std::vector<unsigned char> z;
+    z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    z.push_back(0x78);
+    z.push_back(0x01);
+    size_t pos = 0;
+    do
+    {
+        size_t len = raw.size() - pos;
+        if (len > 65535)
+            len = 65535;
+        bool last = pos + len == raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back(len & 0xFF);
+        z.push_back((len >> 8) & 0xFF);
+        z.push_back(~len & 0xFF);
+        z.push_back((~len >> 8) & 0xFF);
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+    unsigned int a = 1, b = 0;
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    putU32(z, (b << 16) | a);
+
+    std::vector<unsigned char> file;
+    static const unsigned char signature[8] = {0x89, 'P',  'N',  'G',
+                                               0x0D, 0x0A, 0x1A, 0x0A};
+    file.insert(file.end(), signature, signature + 8);
+    std::vector<unsigned char> ihdr;
+    putU32(ihdr, width);
+    putU32(ihdr, height);
+    ihdr.push_back(8);                     // bit depth
+    ihdr.push_back(channels == 4 ? 6 : 2); // RGBA or RGB
+    ihdr.push_back(0);                     // deflate
+    ihdr.push_back(0);                     // adaptive filtering
+    ihdr.push_back(0);                     // no interlace
+    putChunk(file, "IHDR", ihdr);
+    putChunk(file, "IDAT", z);
+    putChunk(file, "IEND", std::vector<unsigned char>());
+
+    FILE* f = std::fopen(path, "wb");
+    if (!f)
+        return false;
+    bool ok = std::fwrite(&file[0], 1, file.size(), f) == file.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+} // namespace png
+
+#endif
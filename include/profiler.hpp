@@ -0,0 +1,238 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped CPU profiler. Build with `make PROFILE=1` (defines FPV_PROFILE) to
+// enable it; otherwise every macro below expands to nothing.
+//
+//   PROFILE_SCOPE("Map::createFloor");   // times the enclosing scope
+//   PROFILE_THREAD_NAME("render");       // label for the trace viewer
+//   PROFILE_WRITE_TRACE("trace.json");   // chrome://tracing or Perfetto
+//
+// GpuTimer (gpu_timer.hpp) adds its results as a separate "GPU" track.
+//
+// Each thread records into its own ring buffer, so recording takes no lock:
+// the owning thread is the only writer and publishes its write index with a
+// release store. Zone names must be string literals (only the pointer is
+// kept). When a ring is full the oldest zones are overwritten. Write the
+// trace at a quiet point, e.g. at exit: zones recorded while the trace is
+// being written may be torn.
+
+#ifdef FPV_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace profiler
+{
+
+struct Zone
+{
+    const char* name;
+    uint64_t start, end; // ns since the profiler epoch
+};
+
+class ThreadBuffer
+{
+  public:
+    static const unsigned int CAPACITY = 1 << 16; // power of two
+
+    std::string name;
+    unsigned int id;
+
+    explicit ThreadBuffer(unsigned int id) : id(id), zones(CAPACITY), head(0)
+    {
+    }
+
+    // owning thread only
+    void record(const char* zoneName, uint64_t start, uint64_t end)
+    {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        Zone& zone = zones[index & (CAPACITY - 1)];
+        zone.name = zoneName;
+        zone.start = start;
+        zone.end = end;
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    // the zones still in the ring, oldest first
+    std::vector<Zone> snapshot() const
+    {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+        std::vector<Zone> out;
+        out.reserve(end - begin);
+        for (uint64_t i = begin; i < end; ++i)
+            out.push_back(zones[i & (CAPACITY - 1)]);
+        return out;
+    }
+
+    uint64_t dropped() const
+    {
+        uint64_t end = head.load(std::memory_order_acquire);
+        return end > CAPACITY ? end - CAPACITY : 0;
+    }
+
+  private:
+    std::vector<Zone> zones;
+    std::atomic<uint64_t> head;
+};
+
+// all thread buffers ever created; they outlive their threads so zones of
+// finished workers still end up in the trace
+class Registry
+{
+  public:
+    static Registry& get()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ThreadBuffer* create()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.push_back(new ThreadBuffer((unsigned int)buffers.size() + 1));
+        return buffers.back();
+    }
+
+    std::vector<ThreadBuffer*> all()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffers;
+    }
+
+  private:
+    std::mutex mutex;
+    std::vector<ThreadBuffer*> buffers;
+};
+
+inline uint64_t now()
+{
+    static const std::chrono::steady_clock::time_point epoch =
+        std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch)
+        .count();
+}
+
+inline ThreadBuffer& threadBuffer()
+{
+    static thread_local ThreadBuffer* buffer = Registry::get().create();
+    return *buffer;
+}
+
+inline void setThreadName(const std::string& name)
+{
+    threadBuffer().name = name;
+}
+
+// an extra timeline that is not a CPU thread, e.g. GPU timings. Only one
+// thread may record into it.
+inline ThreadBuffer* createTrack(const std::string& name)
+{
+    ThreadBuffer* track = Registry::get().create();
+    track->name = name;
+    return track;
+}
+
+class Scope
+{
+  public:
+    explicit Scope(const char* name) : name(name), start(now()) {}
+    ~Scope() { threadBuffer().record(name, start, now()); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const char* name;
+    uint64_t start;
+};
+
+inline void writeJsonString(FILE* out, const char* s)
+{
+    std::fputc('"', out);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            std::fputc('\\', out);
+        if ((unsigned char)*s >= 0x20)
+            std::fputc(*s, out);
+    }
+    std::fputc('"', out);
+}
+
+// Chrome trace event format: one complete ("X") event per zone, timestamps in
+// microseconds
+inline bool writeChromeTrace(const char* path)
+{
+    FILE* out = std::fopen(path, "w");
+    if (!out)
+    {
+        std::cout << "ERROR::PROFILER::CANNOT_WRITE: " << path << std::endl;
+        return false;
+    }
+    std::fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    std::vector<ThreadBuffer*> buffers = Registry::get().all();
+    bool first = true;
+    unsigned long zoneCount = 0, dropped = 0;
+    for (unsigned int b = 0; b < buffers.size(); ++b)
+    {
+        ThreadBuffer& buffer = *buffers[b];
+        if (!buffer.name.empty())
+        {
+            std::fprintf(out,
+                         "%s{\"ph\": \"M\", \"name\": \"thread_name\", "
+                         "\"pid\": 1, \"tid\": %u, \"args\": {\"name\": ",
+                         first ? "" : ",\n", buffer.id);
+            writeJsonString(out, buffer.name.c_str());
+            std::fprintf(out, "}}");
+            first = false;
+        }
+        std::vector<Zone> zones = buffer.snapshot();
+        for (unsigned int i = 0; i < zones.size(); ++i)
+        {
+            std::fprintf(out, "%s{\"ph\": \"X\", \"pid\": 1, \"tid\": %u, ",
+                         first ? "" : ",\n", buffer.id);
+            std::fprintf(out, "\"ts\": %.3f, \"dur\": %.3f, \"name\": ",
+                         zones[i].start / 1000.0,
+                         (zones[i].end - zones[i].start) / 1000.0);
+            writeJsonString(out, zones[i].name);
+            std::fprintf(out, "}");
+            first = false;
+        }
+        zoneCount += zones.size();
+        dropped += buffer.dropped();
+    }
+    std::fprintf(out, "\n]}\n");
+    bool ok = std::fclose(out) == 0;
+    std::cout << "profiler: wrote " << zoneCount << " zones to " << path;
+    if (dropped)
+        std::cout << " (" << dropped << " older zones overwritten)";
+    std::cout << std::endl;
+    return ok;
+}
+
+} // namespace profiler
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name)                                                    \
+    profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) profiler::setThreadName(name)
+#define PROFILE_WRITE_TRACE(path) profiler::writeChromeTrace(path)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_WRITE_TRACE(path) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "camera.hpp"
+#include "jobs.hpp"
+#include "map.hpp"
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); // unit length
+    float maxDistance = 100.0f;
+};
+
+struct RayHit
+{
+    bool hit = false;
+    int x = -1, z = -1; // the block, map.map[x * depth + z]
+    glm::vec3 normal = glm::vec3(0.0f); // face entered, 0 if it started inside
+    float distance = 0.0f;
+    glm::vec3 point = glm::vec3(0.0f);
+};
+
+// Amanatides & Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing": steps
+// from cell to cell along the ray, always across the nearer of the next x or
+// z boundary. Every block is solid from below up to its top, so within a cell
+// the ray can only hit through the face it came in by or through the top;
+// the vertical axis needs no stepping of its own. Outside the map is empty.
+inline RayHit castRay(const Map& map, const Ray& ray)
+{
+    RayHit result;
+    const glm::vec3 o = ray.origin, d = ray.direction;
+    int cx = Map::cellOf(o.x), cz = Map::cellOf(o.z);
+    int stepX = d.x > 0.0f ? 1 : -1, stepZ = d.z > 0.0f ? 1 : -1;
+    // ray length between two x (z) boundaries, and to the first one
+    float deltaX = d.x != 0.0f ? std::fabs(1.0f / d.x) : FLT_MAX;
+    float deltaZ = d.z != 0.0f ? std::fabs(1.0f / d.z) : FLT_MAX;
+    float nextX = d.x != 0.0f ? (cx + 0.5f * stepX - o.x) / d.x : FLT_MAX;
+    float nextZ = d.z != 0.0f ? (cz + 0.5f * stepZ - o.z) / d.z : FLT_MAX;
+    float t = 0.0f;
+    glm::vec3 normal(0.0f);
+    while (t <= ray.maxDistance)
+    {
+        bool inside = cx >= 0 && cz >= 0 && cx < map.width && cz < map.depth;
+        if (inside)
+        {
+            float top = map.columnTop[cx * map.depth + cz];
+            float exit = std::min(std::min(nextX, nextZ), ray.maxDistance);
+            float hitAt = -1.0f;
+            if (o.y + d.y * t <= top)
+                hitAt = t; // through the side it entered by
+            else if (o.y + d.y * exit <= top)
+            {
+                hitAt = (top - o.y) / d.y; // down through the top
+                normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            }
+            if (hitAt >= 0.0f)
+            {
+                result.hit = true;
+                result.x = cx;
+                result.z = cz;
+                result.normal = normal;
+                result.distance = hitAt;
+                result.point = o + d * hitAt;
+                return result;
+            }
+        }
+        else if ((cx < 0 && stepX < 0) || (cx >= map.width && stepX > 0) ||
+                 (cz < 0 && stepZ < 0) || (cz >= map.depth && stepZ > 0))
+            break; // off the map and moving away from it
+        if (nextX < nextZ)
+        {
+            t = nextX;
+            nextX += deltaX;
+            cx += stepX;
+            normal = glm::vec3((float)-stepX, 0.0f, 0.0f);
+        }
+        else
+        {
+            t = nextZ;
+            nextZ += deltaZ;
+            cz += stepZ;
+            normal = glm::vec3(0.0f, 0.0f, (float)-stepZ);
+        }
+    }
+    return result;
+}
+
+// what the camera looks at, up to `reach` away
+inline RayHit pickBlock(const Map& map, const Camera& camera,
+                        float reach = 8.0f)
+{
+    Ray ray;
+    ray.origin = camera.Position;
+    ray.direction = camera.Front;
+    ray.maxDistance = reach;
+    return castRay(map, ray);
+}
+
+// many rays at once, split across the job system
+inline void castRays(const Map& map, const Ray* rays, RayHit* hits,
+                     size_t count, JobSystem& jobs = jobSystem())
+{
+    jobs.parallelFor(count, 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            hits[i] = castRay(map, rays[i]);
+    });
+}
+
+// the ray from `from` that ends at `to`
+inline Ray segmentRay(const glm::vec3& from, const glm::vec3& to)
+{
+    Ray ray;
+    ray.origin = from;
+    glm::vec3 delta = to - from;
+    ray.maxDistance = glm::length(delta);
+    if (ray.maxDistance > 0.0f)
+        ray.direction = delta / ray.maxDistance;
+    return ray;
+}
+
+// true when no terrain lies between the two points
+inline bool lineOfSight(const Map& map, const glm::vec3& from,
+                        const glm::vec3& to)
+{
+    return !castRay(map, segmentRay(from, to)).hit;
+}
+
+// visible[i] for the pair from[i], to[i], split across the job system
+inline void lineOfSight(const Map& map, const glm::vec3* from,
+                        const glm::vec3* to, unsigned char* visible,
+                        size_t count, JobSystem& jobs = jobSystem())
+{
+    jobs.parallelFor(count, 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            visible[i] = lineOfSight(map, from[i], to[i]);
+    });
+}
+
+#endif
@@ -4,6 +4,9 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gl_ext.hpp"
+#include "profiler.hpp"
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -13,13 +16,28 @@ class Shader
 {
   public:
     unsigned int ID;
+    // shader source text, read from disk before any GL call is made
+    struct Source
+    {
+        std::string vertexCode;
+        std::string fragmentCode;
+    };
+
+    Shader() : ID(0) {}
+
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
+        build(readSource(vertexPath, fragmentPath));
+    }
+    // 1. retrieve the vertex/fragment source code from filePath; no GL
+    // involved so this can run on any thread
+    // ------------------------------------------------------------------------
+    static Source readSource(const char* vertexPath, const char* fragmentPath)
+    {
+        PROFILE_SCOPE("Shader::readSource");
+        Source source;
         std::ifstream vShaderFile;
         std::ifstream fShaderFile;
         // ensure ifstream objects can throw exceptions:
@@ -38,108 +56,151 @@ class Shader
             vShaderFile.close();
             fShaderFile.close();
             // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            source.vertexCode = vShaderStream.str();
+            source.fragmentCode = fShaderStream.str();
         }
         catch (std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: "
                       << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
+        return source;
+    }
+    // 2. compile and link; needs the GL context
+    // ------------------------------------------------------------------------
+    void build(const Source& source)
+    {
+        submit(source);
+        finish();
+    }
+    // deferred compile: hand the sources to the driver without asking for the
+    // result, so its compiler threads can work while we do something else
+    // ------------------------------------------------------------------------
+    void submit(const Source& source)
+    {
+        PROFILE_SCOPE("Shader::submit");
+        const char* vShaderCode = source.vertexCode.c_str();
+        const char* fShaderCode = source.fragmentCode.c_str();
         // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pendingVertex, 1, &vShaderCode, NULL);
+        glCompileShader(pendingVertex);
         // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(pendingFragment, 1, &fShaderCode, NULL);
+        glCompileShader(pendingFragment);
         // shader Program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
+        glAttachShader(ID, pendingVertex);
+        glAttachShader(ID, pendingFragment);
         glLinkProgram(ID);
+    }
+    // true once finish() will not block. Without KHR_parallel_shader_compile
+    // there is no way to ask, so finish() simply blocks like it used to
+    // ------------------------------------------------------------------------
+    bool isReady() const
+    {
+        if (pendingVertex == 0 || !glExtensions().parallelShaderCompile)
+            return true;
+        GLint done = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+    // reports compile/link errors of a submitted program; after this the
+    // program is usable
+    // ------------------------------------------------------------------------
+    void finish()
+    {
+        if (pendingVertex == 0)
+            return;
+        PROFILE_SCOPE("Shader::finish");
+        checkCompileErrors(pendingVertex, "VERTEX");
+        checkCompileErrors(pendingFragment, "FRAGMENT");
         checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no
         // longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        glDeleteShader(pendingVertex);
+        glDeleteShader(pendingFragment);
+        pendingVertex = pendingFragment = 0;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const { glUseProgram(ID); }
-    // utility uniform functions
+    // utility uniform functions; names are plain C strings so the per-draw
+    // calls do not build std::string temporaries
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setBool(const char* name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(glGetUniformLocation(ID, name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setFloat(const char* name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(glGetUniformLocation(ID, name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(glGetUniformLocation(ID, name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec4(const std::string& name, float x, float y, float z,
+    void setVec4(const char* name, float x, float y, float z,
                  float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+        glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE,
                            &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+        glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE,
                            &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat4(const char* name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+        glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE,
                            &mat[0][0]);
     }
 
-    ~Shader() { glDeleteProgram(ID); }
+    ~Shader()
+    {
+        if (ID != 0)
+            glDeleteProgram(ID);
+    }
 
   private:
+    // shader objects of a submitted program that has not been checked yet
+    unsigned int pendingVertex = 0;
+    unsigned int pendingFragment = 0;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,176 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "handoff.hpp"
+#include "input.hpp"
+#include "profiler.hpp"
+#include "timestep.hpp"
+
+// What the render thread needs from the simulation: the player's pose at
+// the last two ticks, so it can interpolate to the moment it draws, and the
+// crowd as of the last tick.
+struct RenderSnapshot
+{
+    unsigned long tick = 0;
+    double time = -1.0; // clock() when the tick finished, < 0 before the first
+    glm::vec3 previousPosition, position;
+    glm::vec2 look; // yaw, pitch in degrees; not interpolated
+    float zoom = 45.0f;
+    std::vector<glm::vec4> crowd; // Crowd::gatherInstances() at this tick
+    // time of the oldest input event this snapshot is the first to reflect,
+    // < 0 if none; the render thread turns it into input-to-present latency
+    float inputTime = -1.0f;
+    unsigned long inputApplied = 0; // events applied up to this tick
+};
+
+// Runs the simulation on its own thread at the fixed tick rate. Input events
+// go in through a lock-free queue and each tick's result comes out through a
+// triple buffer, so the render thread never waits for a tick and a slow
+// frame never holds up input handling.
+class SimulationThread
+{
+  public:
+    typedef std::function<void(const std::vector<InputEvent>&)> InputFn;
+    typedef std::function<void(float)> TickFn;
+    typedef std::function<void(RenderSnapshot&)> SnapshotFn;
+    typedef std::function<double()> ClockFn;
+
+    SimulationThread() : quit(false), renderedTick(0) {}
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+    ~SimulationThread() { stop(); }
+
+    // the functions run on the simulation thread; `clock` returns seconds,
+    // and event times count from `inputEpoch` on it
+    void start(FixedTimestep& timestep, InputFn input, TickFn tick,
+               SnapshotFn snapshot, ClockFn clock, double inputEpoch = 0.0)
+    {
+        this->timestep = &timestep;
+        this->inputEpoch = inputEpoch;
+        applyInput = input;
+        simulate = tick;
+        fillSnapshot = snapshot;
+        this->clock = clock;
+        quit = false;
+        thread = std::thread(&SimulationThread::loop, this);
+    }
+
+    void stop()
+    {
+        if (!thread.joinable())
+            return;
+        quit = true;
+        thread.join();
+    }
+
+    bool running() const { return thread.joinable(); }
+
+    // render thread: hands an event to the next tick
+    void sendInput(const InputEvent& event)
+    {
+        // a full queue keeps the rest for the next frame rather than block
+        backlog.push_back(event);
+        size_t sent = 0;
+        while (sent < backlog.size() && input.push(backlog[sent]))
+            ++sent;
+        backlog.erase(backlog.begin(), backlog.begin() + sent);
+    }
+
+    // render thread: the newest snapshot, NULL until the first tick
+    const RenderSnapshot* latest()
+    {
+        snapshots.acquire();
+        const RenderSnapshot& s = snapshots.front();
+        return s.time < 0.0 ? NULL : &s;
+    }
+
+    // render thread: everything up to `tick` has been presented
+    void markPresented(unsigned long tick)
+    {
+        renderedTick.store(tick, std::memory_order_relaxed);
+    }
+
+  private:
+    std::thread thread;
+    std::atomic<bool> quit;
+    FixedTimestep* timestep = NULL;
+    InputFn applyInput;
+    TickFn simulate;
+    SnapshotFn fillSnapshot;
+    ClockFn clock;
+    double inputEpoch = 0.0;
+
+    SpscQueue<InputEvent> input;
+    std::vector<InputEvent> backlog; // render thread only
+    TripleBuffer<RenderSnapshot> snapshots;
+    std::atomic<unsigned long> renderedTick;
+
+    void loop()
+    {
+        PROFILE_THREAD_NAME("simulation");
+        unsigned long tick = 0, applied = 0;
+        // oldest input not yet known to be on screen, and the first
+        // snapshot that carried it
+        float pendingInput = -1.0f;
+        unsigned long pendingTick = 0;
+        double last = clock();
+        // as in the single-threaded loop, each tick gets the events stamped
+        // before it ends, however many ticks one pass catches up on
+        TickInput tickInput(last - inputEpoch);
+        while (!quit)
+        {
+            // read first: whatever is sent by now is in the queue
+            double now = clock();
+            InputEvent event;
+            while (input.pop(event))
+                tickInput.push(event);
+            int ticks = tickInput.frame(
+                now - last, *timestep,
+                [&](const std::vector<InputEvent>& events) {
+                    PROFILE_SCOPE("tick");
+                    if (pendingInput >= 0.0f && pendingTick != 0 &&
+                        renderedTick.load(std::memory_order_relaxed) >=
+                            pendingTick)
+                        pendingInput = -1.0f;
+                    if (!events.empty())
+                    {
+                        applyInput(events);
+                        applied += events.size();
+                        if (pendingInput < 0.0f)
+                        {
+                            pendingInput = events[0].time;
+                            pendingTick = 0;
+                        }
+                    }
+                    simulate(timestep->step());
+                    ++tick;
+                });
+            last = now;
+            if (ticks > 0)
+            {
+                RenderSnapshot& s = snapshots.back();
+                fillSnapshot(s);
+                s.tick = tick;
+                s.time = clock();
+                s.inputTime = pendingInput;
+                s.inputApplied = applied;
+                if (pendingInput >= 0.0f && pendingTick == 0)
+                    pendingTick = tick;
+                snapshots.publish();
+            }
+            // sleep until the next tick is due
+            double wait = (1.0 - timestep->alpha()) * timestep->step();
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "entities.hpp"
+#include "profiler.hpp"
+
+// Entities at points, bucketed by the x/z cell they stand in, for "what is
+// near here" queries: AI perception, the lights that reach a tile, what the
+// player can interact with. A cell is `cellSize` blocks on a side and lines
+// up with the block grid (block x covers x - 0.5 .. x + 0.5, as in
+// Map::cellOf).
+//
+// build() is a counting sort. One pass counts the entities per cell, a cell
+// taking a slot of an open-addressed table (linear probing) the first time
+// it is seen. A prefix sum over the table turns the counts into offsets, and
+// a second pass writes each entity into its cell's bucket. The buckets sit
+// back to back in one array, so a query looks up the few cells it overlaps
+// and reads each as one contiguous run.
+class SpatialHash
+{
+  public:
+    struct Item
+    {
+        glm::vec3 position;
+        Entity entity;
+    };
+
+    explicit SpatialHash(float cellSize = 4.0f) : cellSize(cellSize) {}
+
+    void build(const Entity* entities, const glm::vec3* positions,
+               size_t count)
+    {
+        PROFILE_SCOPE("SpatialHash::build");
+        // at most `count` cells in use, so the table stays half empty
+        size_t capacity = 16;
+        while (capacity < 2 * count)
+            capacity *= 2;
+        cells.assign(capacity, Cell());
+        mask = (uint32_t)capacity - 1;
+        occupied = 0;
+
+        slotOf.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t slot =
+                insert(cellOf(positions[i].x), cellOf(positions[i].z));
+            ++cells[slot].count;
+            slotOf[i] = slot;
+        }
+        uint32_t offset = 0;
+        for (size_t slot = 0; slot < cells.size(); ++slot)
+        {
+            cells[slot].begin = offset;
+            offset += cells[slot].count;
+            cells[slot].count = 0; // counts back up as the bucket fills
+        }
+        items.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Cell& cell = cells[slotOf[i]];
+            Item& item = items[cell.begin + cell.count++];
+            item.position = positions[i];
+            item.entity = entities[i];
+        }
+    }
+
+    size_t size() const { return items.size(); }
+    size_t cellCount() const { return occupied; }
+
+    // the bucket of the cell holding `position`, empty when there is none
+    const Item* bucket(const glm::vec3& position, size_t& count) const
+    {
+        uint32_t slot = find(cellOf(position.x), cellOf(position.z));
+        count = slot == NONE ? 0 : cells[slot].count;
+        return slot == NONE ? nullptr : &items[cells[slot].begin];
+    }
+
+    // visit(item) for every entity inside the box, edges included
+    template <typename F>
+    void forEachInBox(const glm::vec3& lo, const glm::vec3& hi,
+                      const F& visit) const
+    {
+        if (items.empty())
+            return;
+        int x1 = cellOf(hi.x), z1 = cellOf(hi.z);
+        for (int x = cellOf(lo.x); x <= x1; ++x)
+            for (int z = cellOf(lo.z); z <= z1; ++z)
+            {
+                uint32_t slot = find(x, z);
+                if (slot == NONE)
+                    continue;
+                const Item* item = &items[cells[slot].begin];
+                const Item* end = item + cells[slot].count;
+                for (; item != end; ++item)
+                {
+                    const glm::vec3& p = item->position;
+                    if (p.x >= lo.x && p.x <= hi.x && p.y >= lo.y &&
+                        p.y <= hi.y && p.z >= lo.z && p.z <= hi.z)
+                        visit(*item);
+                }
+            }
+    }
+
+    // entities inside the box, replacing what `out` held; returns the count
+    size_t queryBox(const glm::vec3& lo, const glm::vec3& hi,
+                    std::vector<Entity>& out) const
+    {
+        out.clear();
+        forEachInBox(lo, hi, [&out](const Item& item) {
+            out.push_back(item.entity);
+        });
+        return out.size();
+    }
+
+    // entities at most `radius` from `center`
+    size_t queryRadius(const glm::vec3& center, float radius,
+                       std::vector<Entity>& out) const
+    {
+        out.clear();
+        const glm::vec3 extent(radius);
+        const float r2 = radius * radius;
+        forEachInBox(center - extent, center + extent,
+                     [&out, &center, r2](const Item& item) {
+                         glm::vec3 d = item.position - center;
+                         if (glm::dot(d, d) <= r2)
+                             out.push_back(item.entity);
+                     });
+        return out.size();
+    }
+
+  private:
+    static const uint32_t NONE = 0xffffffffu;
+
+    struct Cell
+    {
+        int x = 0, z = 0;
+        uint32_t begin = 0;
+        uint32_t count = 0; // 0: the slot is free
+    };
+
+    int cellOf(float p) const
+    {
+        return (int)std::floor((p + 0.5f) / cellSize);
+    }
+
+    static uint32_t hash(int x, int z)
+    {
+        uint32_t h = (uint32_t)x * 0x9e3779b1u ^ (uint32_t)z * 0x85ebca77u;
+        return h ^ h >> 15;
+    }
+
+    // during build() only, while a used slot's count is at least 1
+    uint32_t insert(int x, int z)
+    {
+        uint32_t slot = hash(x, z) & mask;
+        while (cells[slot].count != 0)
+        {
+            if (cells[slot].x == x && cells[slot].z == z)
+                return slot;
+            slot = (slot + 1) & mask;
+        }
+        cells[slot].x = x;
+        cells[slot].z = z;
+        ++occupied;
+        return slot;
+    }
+
+    uint32_t find(int x, int z) const
+    {
+        if (cells.empty())
+            return NONE;
+        uint32_t slot = hash(x, z) & mask;
+        while (cells[slot].count != 0)
+        {
+            if (cells[slot].x == x && cells[slot].z == z)
+                return slot;
+            slot = (slot + 1) & mask;
+        }
+        return NONE;
+    }
+
+    float cellSize;
+    std::vector<Cell> cells; // the open-addressed table
+    uint32_t mask = 0;
+    size_t occupied = 0;
+    std::vector<Item> items;      // every bucket, back to back
+    std::vector<uint32_t> slotOf; // build() scratch: table slot per input
+};
+
+#endif
@@ -0,0 +1,285 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "jobs.hpp"
+#include "profiler.hpp"
+
+// Where a startup stage is allowed to run. CPU stages (file reads, image
+// decode, terrain noise, meshing) are scheduled on the job system; GL stages
+// must run on the thread that owns the context, which is the one calling
+// run().
+enum StageKind
+{
+    STAGE_CPU,
+    STAGE_GL
+};
+
+// A small dependency graph of startup work. Stages are added with the stages
+// they depend on, then run() executes everything as early as the dependencies
+// allow and records when each stage started and finished.
+class StartupGraph
+{
+  public:
+    // a stage returns false to abort startup (e.g. no GL context)
+    typedef std::function<bool()> StageFn;
+    // polled on the context thread; a GL stage whose dependencies are done
+    // still waits until this returns true (e.g. a driver-side compile)
+    typedef std::function<bool()> ReadyFn;
+
+    int add(const std::string& name, StageKind kind, StageFn fn)
+    {
+        return add(name, kind, std::vector<int>(), fn);
+    }
+    int add(const std::string& name, StageKind kind,
+            const std::vector<int>& deps, StageFn fn)
+    {
+        Stage stage;
+        stage.name = name;
+        stage.kind = kind;
+        stage.fn = fn;
+        stage.deps = deps;
+        stages.push_back(stage);
+        int id = (int)stages.size() - 1;
+        for (unsigned int i = 0; i < deps.size(); ++i)
+            stages[deps[i]].dependents.push_back(id);
+        return id;
+    }
+
+    void setReady(int stage, ReadyFn ready) { stages[stage].ready = ready; }
+
+    // runs all stages, GL stages on the calling thread and CPU stages as
+    // jobs. Returns false when a stage failed; stages that were already
+    // running are allowed to finish.
+    bool run(JobSystem& scheduler = jobSystem())
+    {
+        start = Clock::now();
+        completed = 0;
+        failed = false;
+        // without workers the context thread does the CPU stages itself
+        jobs = scheduler.workerCount() > 0 ? &scheduler : NULL;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (unsigned int i = 0; i < stages.size(); ++i)
+        {
+            stages[i].remaining = (int)stages[i].deps.size();
+            if (stages[i].remaining == 0)
+                makeReady((int)i);
+        }
+
+        while (!finished())
+        {
+            int id = takeGLStage();
+            if (id >= 0)
+            {
+                ++running;
+                lock.unlock();
+                execute(id, 0);
+                lock.lock();
+                continue;
+            }
+            // without workers the context thread has to do the CPU work too
+            if (!jobs && !cpuReady.empty())
+            {
+                id = cpuReady.front();
+                cpuReady.pop_front();
+                ++running;
+                lock.unlock();
+                execute(id, 0);
+                lock.lock();
+                continue;
+            }
+            // stages blocked on ready() are polled rather than signalled
+            if (glReady.empty())
+                wake.wait(lock);
+            else
+                wake.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        lock.unlock();
+        // jobs whose stage was dropped after a failure still hold `this`
+        if (jobs)
+            jobs->wait(cpuJobs);
+        wallTime = elapsedMs();
+        return !failed;
+    }
+
+    // per-stage timing plus the chain of stages that bounded startup time
+    void printReport(std::ostream& out) const
+    {
+        char line[200];
+        out << "startup: " << stages.size() << " stages in " << wallTime
+            << " ms" << std::endl;
+        for (unsigned int i = 0; i < stages.size(); ++i)
+        {
+            const Stage& s = stages[i];
+            std::snprintf(line, sizeof(line),
+                          "  %-44s %-3s thread %d  start %8.2f  took %8.2f ms",
+                          s.name.c_str(), s.kind == STAGE_GL ? "GL" : "CPU",
+                          s.thread, s.startMs, s.endMs - s.startMs);
+            out << line << std::endl;
+        }
+
+        std::vector<int> path = criticalPath();
+        out << "  critical path:";
+        for (int i = (int)path.size() - 1; i >= 0; --i)
+            out << (i == (int)path.size() - 1 ? " " : " -> ")
+                << stages[path[i]].name;
+        out << std::endl;
+    }
+
+    double totalMs() const { return wallTime; }
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Stage
+    {
+        std::string name;
+        StageKind kind;
+        StageFn fn;
+        ReadyFn ready;
+        std::vector<int> deps;
+        std::vector<int> dependents;
+        int remaining = 0;
+        int thread = -1;
+        double startMs = 0.0;
+        double endMs = 0.0;
+    };
+
+    std::vector<Stage> stages;
+    std::deque<int> cpuReady;
+    std::deque<int> glReady;
+    JobSystem* jobs = NULL;
+    JobCounter cpuJobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    Clock::time_point start;
+    unsigned int completed = 0;
+    int running = 0;
+    bool failed = false;
+    double wallTime = 0.0;
+
+    double elapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+    }
+
+    // callers hold the mutex; `running` is bumped when a stage is popped so
+    // a failure waits for it to finish
+    void makeReady(int id)
+    {
+        if (stages[id].kind == STAGE_GL)
+        {
+            glReady.push_back(id);
+            return;
+        }
+        cpuReady.push_back(id);
+        // one job per ready stage; it runs whichever stage is first in line
+        if (jobs)
+            jobs->schedule([this]() { runCpuStage(); }, &cpuJobs);
+    }
+
+    // caller holds the mutex
+    int takeGLStage()
+    {
+        for (std::deque<int>::iterator it = glReady.begin();
+             it != glReady.end(); ++it)
+        {
+            int id = *it;
+            if (!stages[id].ready || stages[id].ready())
+            {
+                glReady.erase(it);
+                return id;
+            }
+        }
+        return -1;
+    }
+
+    bool finished() const
+    {
+        if (failed)
+            return running == 0;
+        return completed == stages.size();
+    }
+
+    void execute(int id, int thread)
+    {
+        Stage& s = stages[id];
+        s.thread = thread;
+        s.startMs = elapsedMs();
+        bool ok = s.fn();
+        s.endMs = elapsedMs();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            ++completed;
+            if (!ok)
+            {
+                std::cout << "ERROR::STARTUP::STAGE_FAILED: " << s.name
+                          << std::endl;
+                failed = true;
+                cpuReady.clear();
+                glReady.clear();
+            }
+            else if (!failed)
+            {
+                for (unsigned int i = 0; i < s.dependents.size(); ++i)
+                {
+                    int next = s.dependents[i];
+                    if (--stages[next].remaining == 0)
+                        makeReady(next);
+                }
+            }
+        }
+        wake.notify_all();
+    }
+
+    void runCpuStage()
+    {
+        int id;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cpuReady.empty())
+                return;
+            id = cpuReady.front();
+            cpuReady.pop_front();
+            ++running;
+        }
+        execute(id, jobs->currentThread());
+    }
+
+    // walks back from the last stage to finish, always following the
+    // dependency that finished last. Dependencies are added before the
+    // stages that need them, so the walk only goes to lower ids and ends.
+    std::vector<int> criticalPath() const
+    {
+        std::vector<int> path;
+        int current = -1;
+        for (unsigned int i = 0; i < stages.size(); ++i)
+            if (current < 0 || stages[i].endMs > stages[current].endMs)
+                current = (int)i;
+        while (current >= 0)
+        {
+            path.push_back(current);
+            const Stage& s = stages[current];
+            int next = -1;
+            for (unsigned int i = 0; i < s.deps.size(); ++i)
+                if (next < 0 || stages[s.deps[i]].endMs > stages[next].endMs)
+                    next = s.deps[i];
+            current = next;
+        }
+        return path;
+    }
+};
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "gl_ext.hpp"
+
+// Ring buffer for data that is rewritten every frame (instance transforms,
+// light lists, streamed vertices). With buffer storage the whole ring is
+// mapped once and stays mapped; each frame writes its own region and a fence
+// tells us when the GPU is done reading it. On plain GL 3.3 the buffer is
+// orphaned and mapped again every frame instead.
+//
+//   stream.beginFrame();
+//   StreamBuffer::Allocation a = stream.allocate(bytes, 16);
+//   memcpy(a.ptr, data, bytes);
+//   stream.finishWrites();
+//   ... draw using a.offset ...
+//   stream.endFrame();
+class StreamBuffer
+{
+  public:
+    static const int FRAMES = 3;
+
+    struct Allocation
+    {
+        void* ptr = NULL;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+        bool valid() const { return ptr != NULL; }
+    };
+
+    struct Stats
+    {
+        unsigned long frames = 0;
+        unsigned long stalls = 0;    // frames that had to wait for a fence
+        double stallMs = 0.0;        // total time spent waiting
+        unsigned long overflows = 0; // allocations that did not fit
+        GLsizeiptr peakBytes = 0;    // most bytes used in a single frame
+    };
+
+    unsigned int ID = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+
+    StreamBuffer() {}
+    StreamBuffer(GLenum target, GLsizeiptr frameSize)
+    {
+        init(target, frameSize);
+    }
+    ~StreamBuffer() { destroy(); }
+    // owns a mapping and fences, so it cannot be copied
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    void init(GLenum target, GLsizeiptr frameSize)
+    {
+        destroy();
+        this->target = target;
+        this->frameSize = frameSize;
+        persistent = glExtensions().bufferStorage;
+
+        glGenBuffers(1, &ID);
+        glBindBuffer(target, ID);
+        if (persistent)
+        {
+            GLbitfield flags =
+                GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glExtensions().BufferStorage(target, frameSize * FRAMES, NULL,
+                                         flags);
+            base = (unsigned char*)glMapBufferRange(
+                target, 0, frameSize * FRAMES, flags);
+            if (base == NULL)
+            {
+                std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAP_FAILED"
+                          << std::endl;
+                glDeleteBuffers(1, &ID);
+                glGenBuffers(1, &ID);
+                glBindBuffer(target, ID);
+                persistent = false;
+            }
+        }
+        if (!persistent)
+            glBufferData(target, frameSize, NULL, GL_STREAM_DRAW);
+        glBindBuffer(target, 0);
+    }
+
+    void destroy()
+    {
+        if (ID == 0)
+            return;
+        for (int i = 0; i < FRAMES; ++i)
+        {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        glBindBuffer(target, ID);
+        if (base)
+            glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+        base = NULL;
+        mapped = NULL;
+    }
+
+    // waits until the GPU released this frame's region, then makes it
+    // writable
+    void beginFrame()
+    {
+        used = 0;
+        if (persistent)
+        {
+            waitFence(region);
+            mapped = base + region * frameSize;
+            regionOffset = region * frameSize;
+        }
+        else
+        {
+            // orphan: the driver hands us fresh storage while the GPU keeps
+            // reading the old one
+            glBindBuffer(target, ID);
+            glBufferData(target, frameSize, NULL, GL_STREAM_DRAW);
+            mapped = (unsigned char*)glMapBufferRange(
+                target, 0, frameSize,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            regionOffset = 0;
+        }
+    }
+
+    // returns an invalid allocation when the frame's region is full
+    Allocation allocate(GLsizeiptr size, GLsizeiptr align = 16)
+    {
+        Allocation a;
+        GLsizeiptr start = (used + align - 1) / align * align;
+        if (mapped == NULL || start + size > frameSize)
+        {
+            ++stats.overflows;
+            return a;
+        }
+        used = start + size;
+        a.ptr = mapped + start;
+        a.offset = regionOffset + start;
+        a.size = size;
+        return a;
+    }
+
+    // call once this frame's data is written, before drawing from it: the
+    // orphaning path may not keep the buffer mapped while the GPU reads it
+    void finishWrites()
+    {
+        if (persistent || mapped == NULL)
+            return;
+        glBindBuffer(target, ID);
+        glUnmapBuffer(target);
+        mapped = NULL;
+    }
+
+    // call after the draws that read this frame's allocations were issued
+    void endFrame()
+    {
+        if (used > stats.peakBytes)
+            stats.peakBytes = used;
+        ++stats.frames;
+        if (persistent)
+        {
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (region + 1) % FRAMES;
+        }
+        else if (mapped)
+        {
+            glBindBuffer(target, ID);
+            glUnmapBuffer(target);
+        }
+        mapped = NULL;
+    }
+
+    bool isPersistent() const { return persistent; }
+    GLsizeiptr capacity() const { return frameSize; }
+    const Stats& getStats() const { return stats; }
+
+    void print(std::ostream& out, const char* name) const
+    {
+        if (ID == 0 || stats.frames == 0)
+            return;
+        out << name << ": " << (persistent ? "persistent" : "orphaned")
+            << ", peak " << stats.peakBytes << " of " << frameSize
+            << " bytes a frame, " << stats.stalls << " fence stall(s) ("
+            << stats.stallMs << " ms), " << stats.overflows
+            << " overflow(s) in " << stats.frames << " frames" << std::endl;
+    }
+
+  private:
+    GLsizeiptr frameSize = 0;
+    GLsizeiptr used = 0;
+    GLintptr regionOffset = 0;
+    int region = 0;
+    bool persistent = false;
+    unsigned char* base = NULL;
+    unsigned char* mapped = NULL;
+    GLsync fences[FRAMES] = {0, 0, 0};
+    Stats stats;
+
+    void waitFence(int index)
+    {
+        if (!fences[index])
+            return;
+        GLenum result = glClientWaitSync(fences[index], 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            do
+            {
+                result = glClientWaitSync(fences[index],
+                                          GL_SYNC_FLUSH_COMMANDS_BIT,
+                                          1000000); // 1 ms
+            } while (result == GL_TIMEOUT_EXPIRED);
+            ++stats.stalls;
+            stats.stallMs += std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        }
+        glDeleteSync(fences[index]);
+        fences[index] = 0;
+    }
+};
+
+#endif
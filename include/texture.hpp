@@ -11,23 +11,48 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "profiler.hpp"
+
 class Texture
 {
   public:
     // the texture ID
     unsigned int ID;
 
+    // decoded pixels waiting for upload; decode() only touches the CPU so it
+    // can run on any thread
+    struct Image
+    {
+        int width = 0, height = 0, nrChannels = 0;
+        unsigned char* data = NULL;
+    };
+
+    Texture() : ID(0) {}
+
     // constructor reads and builds the texture
     Texture(const char* imgPath)
     {
-        stbi_set_flip_vertically_on_load(true);
-        int width, height, nrChannels;
-        unsigned char* data =
-            stbi_load(imgPath, &width, &height, &nrChannels, 0);
+        Image image = decode(imgPath);
+        upload(image);
+    }
 
-        std::cout << imgPath << ": " << width << "x" << height << " "
-                  << std::endl;
+    static Image decode(const char* imgPath)
+    {
+        PROFILE_SCOPE("Texture::decode");
+        Image image;
+        stbi_set_flip_vertically_on_load_thread(true);
+        image.data = stbi_load(imgPath, &image.width, &image.height,
+                               &image.nrChannels, 0);
+
+        std::cout << imgPath << ": " << image.width << "x" << image.height
+                  << " " << std::endl;
+        return image;
+    }
 
+    // creates the GL texture from decoded pixels and frees them
+    void upload(Image& image)
+    {
+        PROFILE_SCOPE("Texture::upload");
         glGenTextures(1, &ID);
         glBindTexture(GL_TEXTURE_2D, ID);
         // set the texture wrapping/filtering options (on the currently bound
@@ -39,26 +64,27 @@ class Texture
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         unsigned int format;
-        if (nrChannels == 4)
+        if (image.nrChannels == 4)
         {
             format = GL_RGBA;
         }
-        else if (nrChannels == 3)
+        else if (image.nrChannels == 3)
         {
             format = GL_RGB;
         }
 
-        if (data)
+        if (image.data)
         {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, format,
-                         GL_UNSIGNED_BYTE, data);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height,
+                         0, format, GL_UNSIGNED_BYTE, image.data);
             glGenerateMipmap(GL_TEXTURE_2D);
         }
         else
         {
             std::cout << "Failed to load texture" << std::endl;
         }
-        stbi_image_free(data);
+        stbi_image_free(image.data);
+        image.data = NULL;
     }
     void active2D()
     {
@@ -0,0 +1,84 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+// Fixed-rate simulation clock. Each frame adds its real (or replayed) delta
+// to an accumulator and gets back how many ticks of exactly `step()` seconds
+// to simulate; whatever is left over becomes the interpolation factor for
+// rendering between the last two ticks. After a long stall at most
+// `maxTicks` ticks run in one frame and the rest of the backlog is dropped,
+// so a slow frame cannot snowball into ever longer catch-ups.
+class FixedTimestep
+{
+  public:
+    explicit FixedTimestep(double hz = 60.0, int maxTicks = 5)
+    {
+        configure(hz, maxTicks);
+    }
+
+    void configure(double hz, int maxTicks)
+    {
+        stepSeconds = 1.0 / (hz > 0.0 ? hz : 60.0);
+        this->maxTicks = maxTicks > 0 ? maxTicks : 1;
+    }
+
+    // ticks to simulate for a frame that took `frameSeconds`
+    int advance(double frameSeconds)
+    {
+        if (frameSeconds > 0.0)
+            accumulator += frameSeconds;
+        int ticks = (int)(accumulator / stepSeconds);
+        if (ticks > maxTicks)
+        {
+            droppedSeconds += accumulator - maxTicks * stepSeconds;
+            ++clampedFrames;
+            ticks = maxTicks;
+            accumulator = maxTicks * stepSeconds;
+        }
+        accumulator -= ticks * stepSeconds;
+        totalTicks += ticks;
+        return ticks;
+    }
+
+    float step() const { return (float)stepSeconds; }
+
+    // how far rendering is between the previous and the latest tick, [0, 1)
+    float alpha() const { return (float)(accumulator / stepSeconds); }
+
+    unsigned long ticks() const { return totalTicks; }
+
+    void print(std::ostream& out) const
+    {
+        out << "simulation: " << totalTicks << " ticks at "
+            << 1.0 / stepSeconds << " Hz";
+        if (clampedFrames)
+            out << ", " << clampedFrames << " frame(s) over the catch-up "
+                << "limit dropped " << droppedSeconds * 1000.0 << " ms";
+        out << std::endl;
+    }
+
+  private:
+    double stepSeconds = 1.0 / 60.0;
+    int maxTicks = 5;
+    double accumulator = 0.0;
+    unsigned long totalTicks = 0;
+    unsigned long clampedFrames = 0;
+    double droppedSeconds = 0.0;
+};
+
+// A value simulated at the tick rate and read back in between: call
+// beginTick() before a tick changes `current`, render with at(alpha).
+template <typename T> struct Interpolated
+{
+    T previous = T();
+    T current = T();
+
+    void reset(const T& value) { previous = current = value; }
+    void beginTick() { previous = current; }
+    T at(float alpha) const { return glm::mix(previous, current, alpha); }
+};
+
+#endif
@@ -0,0 +1,18 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 3) in vec4 aInstance; // feet position, tint
+
+out vec3 color;
+
+uniform vec3 size; // box width, height, depth
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec3 world = aInstance.xyz + (aPos + vec3(0.0, 0.5, 0.0)) * size;
+    gl_Position = projection * view * vec4(world, 1.0);
+    // darker towards the feet so the boxes read as figures
+    vec3 tint = mix(vec3(0.85, 0.35, 0.2), vec3(0.2, 0.45, 0.9), aInstance.w);
+    color = tint * (0.55 + 0.45 * (aPos.y + 0.5));
+}
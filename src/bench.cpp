@@ -0,0 +1,753 @@
+// CPU micro-benchmarks for the hot paths of the demo. Runs without a window
+// or GL context:
+//
+//   make runbench BENCH_ARGS="--filter terrain --reps 20"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "arena.hpp"
+#include "bench.hpp"
+#include "broadphase.hpp"
+#include "crowd.hpp"
+#include "ground_follow.hpp"
+#include "height_pyramid.hpp"
+#include "jobs.hpp"
+#include "map.hpp"
+#include "person.hpp"
+#include "physics.hpp"
+#include "raycast.hpp"
+#include "snake.hpp"
+#include "spatial_hash.hpp"
+#include "texture.hpp"
+
+// same size as the scene map in main.cpp
+static const int MAP_SIZE = 100;
+
+static const Map& sceneMap()
+{
+    static Map map(MAP_SIZE, MAP_SIZE);
+    return map;
+}
+
+// terrain and meshing
+// -------------------
+BENCH(terrain_generate)
+{
+    Map map;
+    state.setItems(MAP_SIZE * MAP_SIZE);
+    while (state.keepRunning())
+    {
+        map.generate(MAP_SIZE, MAP_SIZE);
+        bench::keep(map.map);
+    }
+}
+
+BENCH(noise_perlin_256x256)
+{
+    FastNoiseLite noise;
+    noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+    noise.SetFrequency(0.1f);
+    noise.SetSeed(1337);
+    state.setItems(256 * 256);
+    while (state.keepRunning())
+    {
+        float sum = 0.0f;
+        for (int x = 0; x < 256; ++x)
+            for (int z = 0; z < 256; ++z)
+                sum += noise.GetNoise(x * 0.5f, z * 0.5f);
+        bench::keep(sum);
+    }
+}
+
+BENCH(mesh_floor_transforms)
+{
+    Map map = sceneMap();
+    state.setItems(map.map.size());
+    while (state.keepRunning())
+    {
+        map.buildFloorTransforms();
+        bench::keep(map.floorTransforms);
+    }
+}
+
+// culling and transforms
+// ----------------------
+static glm::mat4 benchViewProjection()
+{
+    glm::mat4 projection =
+        glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(10.0f, 15.0f, 10.0f),
+                                 glm::vec3(50.0f, 5.0f, 50.0f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    return projection * view;
+}
+
+// frustum planes (Gribb/Hartmann) against each floor cube's bounding box
+BENCH(cull_floor_frustum)
+{
+    const Map& map = sceneMap();
+    glm::mat4 m = glm::transpose(benchViewProjection());
+    glm::vec4 planes[6] = {m[3] + m[0], m[3] - m[0], m[3] + m[1],
+                           m[3] - m[1], m[3] + m[2], m[3] - m[2]};
+    state.setItems(map.map.size());
+    while (state.keepRunning())
+    {
+        unsigned int visible = 0;
+        for (size_t i = 0; i < map.map.size(); ++i)
+        {
+            glm::vec3 lo = map.map[i].pos - 0.5f, hi = map.map[i].pos + 0.5f;
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p)
+            {
+                glm::vec3 far(planes[p].x > 0 ? hi.x : lo.x,
+                              planes[p].y > 0 ? hi.y : lo.y,
+                              planes[p].z > 0 ? hi.z : lo.z);
+                inside =
+                    glm::dot(glm::vec3(planes[p]), far) + planes[p].w >= 0;
+            }
+            visible += inside;
+        }
+        bench::keep(visible);
+    }
+}
+
+BENCH(matrix_batch_mvp)
+{
+    const Map& map = sceneMap();
+    glm::mat4 viewProjection = benchViewProjection();
+    std::vector<glm::mat4> out(map.floorTransforms.size());
+    state.setItems(out.size());
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < out.size(); ++i)
+            out[i] = viewProjection * map.floorTransforms[i];
+        bench::keep(out);
+    }
+}
+
+// gameplay
+// --------
+BENCH(height_follow)
+{
+    const Map& map = sceneMap();
+    Person player(Camera(glm::vec3(1.0f, 10.0f, 1.0f)), glm::vec3(0.0f));
+    const int steps = 1000;
+    state.setItems(steps);
+    while (state.keepRunning())
+    {
+        for (int i = 0; i < steps; ++i)
+        {
+            player.camera.Position.x = (float)(i * 7 % (MAP_SIZE - 1));
+            player.camera.Position.z = (float)(i * 13 % (MAP_SIZE - 1));
+            player.Update_yPos(1.0f / 60.0f, map.heightMap);
+        }
+        bench::keep(player.camera.Position);
+    }
+}
+
+// a crowd spread over the scene map, each walking its own direction, one
+// physics step per body per iteration; at `speed` 200 a body crosses over
+// three cells a tick, which is what the swept walk has to pay for
+static void physicsCrowd(bench::State& state, int count, float speed)
+{
+    const Map& map = sceneMap();
+    std::vector<Body> bodies(count);
+    std::vector<glm::vec3> walk(count);
+    for (int i = 0; i < count; ++i)
+    {
+        bodies[i].position = glm::vec3((float)(i * 7 % (MAP_SIZE - 2) + 1),
+                                       20.0f,
+                                       (float)(i * 13 % (MAP_SIZE - 2) + 1));
+        float angle = i * 2.39996f;
+        walk[i] = glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * speed;
+    }
+    for (int step = 0; step < 120; ++step) // land everyone first
+        for (int i = 0; i < count; ++i)
+            stepBody(bodies[i], map, 1.0f / 60.0f);
+    state.setItems(count);
+    while (state.keepRunning())
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            bodies[i].velocity.x = walk[i].x;
+            bodies[i].velocity.z = walk[i].z;
+            stepBody(bodies[i], map, 1.0f / 60.0f);
+            // turn back from walls so no one stays parked against one
+            if (bodies[i].velocity.x == 0.0f)
+                walk[i].x = -walk[i].x;
+            if (bodies[i].velocity.z == 0.0f)
+                walk[i].z = -walk[i].z;
+        }
+        bench::keep(bodies[0].position);
+    }
+}
+
+BENCH(physics_walk_1000)
+{
+    physicsCrowd(state, 1000, 5.0f);
+}
+
+BENCH(physics_walk_4096)
+{
+    physicsCrowd(state, 4096, 5.0f);
+}
+
+BENCH(physics_fast_1000)
+{
+    physicsCrowd(state, 1000, 200.0f);
+}
+
+// rays from above the terrain in every direction, as many as a crowd of
+// line-of-sight checks would cast
+static std::vector<Ray> terrainRays(int size, size_t count)
+{
+    std::vector<Ray> rays(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        float yaw = i * 2.39996f, pitch = -0.1f - (i % 17) * 0.05f;
+        rays[i].origin = glm::vec3((float)(i * 7 % size), 12.0f,
+                                   (float)(i * 13 % size));
+        rays[i].direction =
+            glm::vec3(std::cos(yaw) * std::cos(pitch), std::sin(pitch),
+                      std::sin(yaw) * std::cos(pitch));
+        rays[i].maxDistance = 64.0f;
+    }
+    return rays;
+}
+
+BENCH(raycast_terrain_4096)
+{
+    const Map& map = sceneMap();
+    std::vector<Ray> rays = terrainRays(MAP_SIZE, 4096);
+    std::vector<RayHit> hits(rays.size());
+    state.setItems(rays.size());
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < rays.size(); ++i)
+            hits[i] = castRay(map, rays[i]);
+        bench::keep(hits);
+    }
+}
+
+// a 4096 x 4096 terrain (about 350 MB with the block list), built on first
+// use by the benchmarks that need it
+static const Map& largeMap()
+{
+    static Map map;
+    if (map.width == 0)
+        map.generate(4096, 4096);
+    return map;
+}
+
+// long, shallow rays as shadow or horizon tests would cast them, where the
+// per-cell walk pays for every block it passes over
+static std::vector<Ray> horizonRays(int size, size_t count)
+{
+    std::vector<Ray> rays(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        float yaw = i * 2.39996f, pitch = -0.002f - (i % 13) * 0.001f;
+        rays[i].origin = glm::vec3((float)(i * 2654435761u % size), 12.0f,
+                                   (float)(i * 40503u % size));
+        rays[i].direction =
+            glm::vec3(std::cos(yaw) * std::cos(pitch), std::sin(pitch),
+                      std::sin(yaw) * std::cos(pitch));
+        rays[i].maxDistance = 2048.0f;
+    }
+    return rays;
+}
+
+BENCH(raycast_dda_4096_map)
+{
+    const Map& map = largeMap();
+    std::vector<Ray> rays = horizonRays(map.width, 256);
+    std::vector<RayHit> hits(rays.size());
+    state.setItems(rays.size());
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < rays.size(); ++i)
+            hits[i] = castRay(map, rays[i]);
+        bench::keep(hits);
+    }
+}
+
+BENCH(raycast_pyramid_4096_map)
+{
+    HeightPyramid pyramid;
+    pyramid.build(largeMap());
+    std::vector<Ray> rays = horizonRays(largeMap().width, 256);
+    std::vector<RayHit> hits(rays.size());
+    state.setItems(rays.size());
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; i < rays.size(); ++i)
+            hits[i] = pyramid.castRay(rays[i]);
+        bench::keep(hits);
+    }
+}
+
+BENCH(pyramid_build_4096_map)
+{
+    const Map& map = largeMap();
+    HeightPyramid pyramid;
+    state.setItems(map.columnTop.size());
+    while (state.keepRunning())
+        pyramid.build(map);
+}
+
+// one block changing, the pyramid above it refreshed
+BENCH(pyramid_update_4096_map)
+{
+    const Map& map = largeMap();
+    HeightPyramid pyramid;
+    pyramid.build(map);
+    unsigned int i = 0;
+    state.setItems(1);
+    while (state.keepRunning())
+    {
+        i = i * 1664525u + 1013904223u;
+        pyramid.update(map, (int)(i >> 20), (int)(i >> 8 & 4095));
+    }
+    bench::keep(pyramid);
+}
+
+// one tick of the crowd movement system for 100k walkers
+BENCH(crowd_update_100k)
+{
+    const Map& map = sceneMap();
+    Crowd crowd;
+    crowd.populate(map, 100000);
+    state.setItems(crowd.positions.size());
+    while (state.keepRunning())
+        crowd.update(map, 1.0f / 60.0f);
+    bench::keep(crowd.positions[0]);
+}
+
+// eye heights of 4096 followers spread over the scene map, eased towards the
+// ground once per iteration: a Person each, then the batched versions
+struct Followers
+{
+    HeightField field;
+    std::vector<float> x, z, y;
+
+    explicit Followers(size_t count) : x(count), z(count), y(count, 10.0f)
+    {
+        field.build(sceneMap().heightMap, sceneMap().width, sceneMap().depth);
+        for (size_t i = 0; i < count; ++i)
+        {
+            x[i] = (float)(i * 7 % (MAP_SIZE * 10)) / 10.0f;
+            z[i] = (float)(i * 13 % (MAP_SIZE * 10)) / 10.0f;
+        }
+    }
+};
+
+BENCH(ground_follow_person_4096)
+{
+    const Map& map = sceneMap();
+    Followers f(4096);
+    std::vector<Person> persons;
+    for (size_t i = 0; i < f.x.size(); ++i)
+        persons.push_back(Person(Camera(glm::vec3(f.x[i], 10.0f, f.z[i])),
+                                 glm::vec3(0.0f)));
+    state.setItems(persons.size());
+    while (state.keepRunning())
+        for (size_t i = 0; i < persons.size(); ++i)
+            persons[i].Update_yPos(1.0f / 60.0f, map.heightMap);
+    bench::keep(persons[0].camera.Position);
+}
+
+BENCH(ground_follow_scalar_4096)
+{
+    Followers f(4096);
+    state.setItems(f.x.size());
+    while (state.keepRunning())
+        followGroundScalar(f.field, &f.x[0], &f.z[0], &f.y[0], f.x.size(),
+                           3.0f, 0.1f);
+    bench::keep(f.y);
+}
+
+// AVX2 where the CPU has it
+BENCH(ground_follow_batch_4096)
+{
+    Followers f(4096);
+    state.setItems(f.x.size());
+    while (state.keepRunning())
+        followGround(f.field, &f.x[0], &f.z[0], &f.y[0], f.x.size(), 3.0f,
+                     0.1f);
+    bench::keep(f.y);
+}
+
+// broad phase: walkers as boxes the size of a person on a square floor, about
+// one per four square blocks, the overlapping pairs found once per tick.
+// Walking moves each a little, so the sort order barely changes between
+// ticks; scattering puts each somewhere new, which is the worst case for the
+// sweep's insertion sort
+enum class Motion
+{
+    still,
+    walk,
+    scatter
+};
+
+template <typename Broadphase>
+static void broadphaseTick(bench::State& state, size_t count, Motion motion)
+{
+    const float side = 2.0f * std::sqrt((float)count), dt = 1.0f / 60.0f;
+    const glm::vec3 extent(0.3f, 3.2f, 0.3f);
+    unsigned int seed = 0x9e3779b9u;
+    auto random = [&seed](float range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f * range;
+    };
+    std::vector<glm::vec3> position(count), velocity(count);
+    Broadphase broadphase;
+    for (size_t i = 0; i < count; ++i)
+    {
+        position[i] = glm::vec3(random(side), 0.0f, random(side));
+        float angle = random(6.2831853f);
+        velocity[i] = 2.0f * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+        Aabb box;
+        box.lo = position[i] - glm::vec3(extent.x, 0.0f, extent.z);
+        box.hi = position[i] + extent;
+        broadphase.add((Entity)i, box);
+    }
+    std::vector<EntityPair> pairs;
+    broadphase.update(pairs);
+    state.setItems(count);
+    while (state.keepRunning())
+    {
+        for (size_t i = 0; motion != Motion::still && i < count; ++i)
+        {
+            glm::vec3& p = position[i];
+            if (motion == Motion::scatter)
+                p = glm::vec3(random(side), 0.0f, random(side));
+            else
+            {
+                p += velocity[i] * dt;
+                if (p.x < 0.0f || p.x > side || p.z < 0.0f || p.z > side)
+                    velocity[i] = -velocity[i];
+            }
+            Aabb box;
+            box.lo = p - glm::vec3(extent.x, 0.0f, extent.z);
+            box.hi = p + extent;
+            broadphase.move((typename Broadphase::Proxy)i, box);
+        }
+        broadphase.update(pairs);
+    }
+    bench::keep(pairs);
+}
+
+static bool registerBroadphase()
+{
+    const size_t counts[] = {10000, 100000, 1000000};
+    const char* countNames[] = {"10k", "100k", "1m"};
+    const Motion motions[] = {Motion::still, Motion::walk, Motion::scatter};
+    const char* motionNames[] = {"still", "walk", "scatter"};
+    for (int c = 0; c < 3; ++c)
+        for (int m = 0; m < 3; ++m)
+        {
+            size_t count = counts[c];
+            Motion motion = motions[m];
+            std::string suffix =
+                std::string(motionNames[m]) + "_" + countNames[c];
+            bench::Register("broadphase_sap_" + suffix,
+                            [count, motion](bench::State& state) {
+                                broadphaseTick<SweepAndPrune>(state, count,
+                                                              motion);
+                            });
+            bench::Register("broadphase_grid_" + suffix,
+                            [count, motion](bench::State& state) {
+                                broadphaseTick<GridBroadphase>(state, count,
+                                                               motion);
+                            });
+        }
+    return true;
+}
+
+static bool broadphaseRegistered = registerBroadphase();
+
+// the spatial hash over 100k walkers on a 632 x 632 floor (one per four
+// square blocks), rebuilt as every tick would, then queried the way AI
+// perception would ask: what is within 8 blocks of each of 1000 walkers
+struct HashedCrowd
+{
+    std::vector<Entity> ids;
+    std::vector<glm::vec3> points;
+    SpatialHash hash;
+
+    explicit HashedCrowd(size_t count) : ids(count), points(count)
+    {
+        const float side = 2.0f * std::sqrt((float)count);
+        unsigned int seed = 0x2545f491u;
+        for (size_t i = 0; i < count; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            float x = (seed >> 8) / 16777216.0f * side;
+            seed = seed * 1664525u + 1013904223u;
+            float z = (seed >> 8) / 16777216.0f * side;
+            ids[i] = (Entity)i;
+            points[i] = glm::vec3(x, 0.0f, z);
+        }
+        hash.build(&ids[0], &points[0], count);
+    }
+};
+
+BENCH(spatial_hash_build_100k)
+{
+    HashedCrowd crowd(100000);
+    state.setItems(crowd.ids.size());
+    while (state.keepRunning())
+        crowd.hash.build(&crowd.ids[0], &crowd.points[0], crowd.ids.size());
+    bench::keep(crowd.hash);
+}
+
+BENCH(spatial_hash_build_1m)
+{
+    HashedCrowd crowd(1000000);
+    state.setItems(crowd.ids.size());
+    while (state.keepRunning())
+        crowd.hash.build(&crowd.ids[0], &crowd.points[0], crowd.ids.size());
+    bench::keep(crowd.hash);
+}
+
+BENCH(spatial_hash_radius_8_100k)
+{
+    HashedCrowd crowd(100000);
+    std::vector<Entity> found;
+    size_t total = 0;
+    state.setItems(1000);
+    while (state.keepRunning())
+        for (size_t i = 0; i < 1000; ++i)
+            total += crowd.hash.queryRadius(crowd.points[i * 97], 8.0f, found);
+    bench::keep(total);
+}
+
+BENCH(spatial_hash_box_8_100k)
+{
+    HashedCrowd crowd(100000);
+    std::vector<Entity> found;
+    const glm::vec3 extent(8.0f);
+    size_t total = 0;
+    state.setItems(1000);
+    while (state.keepRunning())
+        for (size_t i = 0; i < 1000; ++i)
+            total += crowd.hash.queryBox(crowd.points[i * 97] - extent,
+                                         crowd.points[i * 97] + extent, found);
+    bench::keep(total);
+}
+
+// a 128 segment snake circling a square, so it never dies and every step
+// runs the full self-collision scan
+BENCH(snake_update)
+{
+    Snake snake(1024, 1024);
+    for (int i = 0; i < 125; ++i)
+        snake.body.push_back(
+            Position(snake.body.back().x - 1.0f, snake.body.back().y));
+    const Direction turns[4] = {P_RIGHT, P_UP, P_LEFT, P_DOWN};
+    const int side = 64;
+    long step = 0;
+    state.setItems(1);
+    while (state.keepRunning())
+    {
+        if (step % side == 0)
+            snake.setDirection(turns[step / side % 4]);
+        ++step;
+        bench::keep(snake.update());
+    }
+}
+
+// transient frame data
+// --------------------
+// a typical frame's scratch work: grow a draw list without reserving, sort
+// it by key and format a few names
+struct DrawItem
+{
+    uint64_t key;
+    unsigned int index;
+    bool operator<(const DrawItem& other) const { return key < other.key; }
+};
+
+static const int FRAME_ITEMS = 10000;
+static const int FRAME_NAMES = 64;
+
+BENCH(frame_scratch_malloc)
+{
+    state.setItems(FRAME_ITEMS);
+    while (state.keepRunning())
+    {
+        std::vector<DrawItem> items;
+        for (int i = 0; i < FRAME_ITEMS; ++i)
+        {
+            DrawItem item = {(uint64_t)(i * 2654435761u % 4096), (unsigned)i};
+            items.push_back(item);
+        }
+        std::sort(items.begin(), items.end());
+        std::vector<std::string> names;
+        for (int i = 0; i < FRAME_NAMES; ++i)
+        {
+            char name[32];
+            int length = std::snprintf(name, sizeof(name),
+                                       "pointLights[%d].position", i);
+            names.push_back(std::string(name, length));
+        }
+        bench::keep(items);
+        bench::keep(names);
+    }
+}
+
+BENCH(frame_scratch_arena)
+{
+    FrameArena arena;
+    state.setItems(FRAME_ITEMS);
+    while (state.keepRunning())
+    {
+        std::vector<DrawItem, ArenaAllocator<DrawItem>> items(arena);
+        for (int i = 0; i < FRAME_ITEMS; ++i)
+        {
+            DrawItem item = {(uint64_t)(i * 2654435761u % 4096), (unsigned)i};
+            items.push_back(item);
+        }
+        std::sort(items.begin(), items.end());
+        std::vector<const char*, ArenaAllocator<const char*>> names(arena);
+        for (int i = 0; i < FRAME_NAMES; ++i)
+        {
+            char name[32];
+            int length = std::snprintf(name, sizeof(name),
+                                       "pointLights[%d].position", i);
+            names.push_back(arena.copy(name, length));
+        }
+        bench::keep(items);
+        bench::keep(names);
+        arena.reset();
+    }
+}
+
+// job system scaling
+// ------------------
+// the same work with 1..N threads (the caller plus N - 1 workers); the other
+// benchmarks never start the job system and so run single threaded
+static void scaleTerrain(bench::State& state, unsigned int threads)
+{
+    const int size = 256;
+    jobSystem().start(threads - 1);
+    Map map;
+    state.setItems(size * size);
+    while (state.keepRunning())
+    {
+        map.generate(size, size);
+        bench::keep(map.map);
+    }
+    jobSystem().stop();
+}
+
+static void scaleCull(bench::State& state, unsigned int threads)
+{
+    jobSystem().start(threads - 1);
+    Map map(256, 256);
+    glm::mat4 viewProjection = benchViewProjection();
+    state.setItems(map.map.size());
+    while (state.keepRunning())
+    {
+        bench::keep(map.cullFloor(viewProjection));
+        FrameArenas::instance().endFrame();
+    }
+    jobSystem().stop();
+}
+
+static void scaleRaycast(bench::State& state, unsigned int threads)
+{
+    jobSystem().start(threads - 1);
+    Map map(256, 256);
+    std::vector<Ray> rays = terrainRays(256, 16384);
+    std::vector<RayHit> hits(rays.size());
+    state.setItems(rays.size());
+    while (state.keepRunning())
+    {
+        castRays(map, &rays[0], &hits[0], rays.size());
+        bench::keep(hits);
+    }
+    jobSystem().stop();
+}
+
+static void scaleCrowd(bench::State& state, unsigned int threads)
+{
+    jobSystem().start(threads - 1);
+    const Map& map = sceneMap();
+    Crowd crowd;
+    crowd.populate(map, 100000);
+    state.setItems(crowd.positions.size());
+    while (state.keepRunning())
+        crowd.update(map, 1.0f / 60.0f);
+    bench::keep(crowd.positions[0]);
+    jobSystem().stop();
+}
+
+// schedule + wait round trip of tiny jobs
+static void scaleOverhead(bench::State& state, unsigned int threads)
+{
+    JobSystem jobs;
+    jobs.start(threads - 1);
+    std::atomic<int> sum(0);
+    state.setItems(1000);
+    while (state.keepRunning())
+    {
+        JobCounter counter;
+        for (int i = 0; i < 1000; ++i)
+            jobs.schedule([&sum]() { sum.fetch_add(1); }, &counter);
+        jobs.wait(counter);
+    }
+    jobs.stop();
+}
+
+static bool registerScaling()
+{
+    unsigned int cores = std::thread::hardware_concurrency();
+    for (unsigned int t = 1; t <= (cores > 0 ? cores : 1); ++t)
+    {
+        std::string suffix = "_" + std::to_string(t) + "t";
+        bench::Register("jobs_terrain_256" + suffix,
+                        [t](bench::State& state) { scaleTerrain(state, t); });
+        bench::Register("jobs_cull_256" + suffix,
+                        [t](bench::State& state) { scaleCull(state, t); });
+        bench::Register("jobs_raycast_16k" + suffix,
+                        [t](bench::State& state) { scaleRaycast(state, t); });
+        bench::Register("jobs_crowd_100k" + suffix,
+                        [t](bench::State& state) { scaleCrowd(state, t); });
+        bench::Register("jobs_overhead_1000" + suffix,
+                        [t](bench::State& state) { scaleOverhead(state, t); });
+    }
+    return true;
+}
+static bool scalingRegistered = registerScaling();
+
+// assets
+// ------
+BENCH(texture_decode_container_jpg)
+{
+    std::ifstream file("media/container.jpg", std::ios::binary);
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)),
+                                     std::istreambuf_iterator<char>());
+    if (bytes.empty())
+    {
+        std::cout << "ERROR::BENCH::MISSING_ASSET: media/container.jpg"
+                  << std::endl;
+        std::exit(2);
+    }
+    while (state.keepRunning())
+    {
+        int width, height, channels;
+        unsigned char* data = stbi_load_from_memory(
+            bytes.data(), (int)bytes.size(), &width, &height, &channels, 0);
+        bench::keep(data);
+        stbi_image_free(data);
+    }
+}
+
+int main(int argc, char** argv) { return bench::runAll(argc, argv); }
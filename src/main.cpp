@@ -4,23 +4,48 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <math.h>
+#include <string>
 #include <vector>
 
 #include "glm/detail/type_vec.hpp"
 #include "FastNoiseLite.h"
 
+#include "arena.hpp"
+#include "crowd.hpp"
 #include "person.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
 #include "map.hpp"
+#include "startup.hpp"
+#include "frame_capture.hpp"
+#include "frame_stats.hpp"
+#include "gl_stats.hpp"
+#include "gpu_timer.hpp"
+#include "histogram.hpp"
+#include "jobs.hpp"
+#include "headless.hpp"
+#include "flythrough.hpp"
+#include "input.hpp"
+#include "profiler.hpp"
+#include "sim_thread.hpp"
+#include "timestep.hpp"
 #include "vertice.hpp"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void key_callback(GLFWwindow* window, int key, int scancode, int action,
+                  int mods);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void applyInput(const std::vector<InputEvent>& events);
+static double now();
+static float inputTime();
 
 // settings
 #define MAP_WIDTH 100
@@ -31,13 +56,43 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 Person player(Camera(glm::vec3(0.0f, 10.0f, 15.0f)),
               glm::vec3(0.0f, 7.0f, 15.0f));
 
+// NPC walkers, simulated alongside the player; --npcs sets how many
+Crowd crowd;
+
 bool firstMouse = true;
 float lastX = SCR_WIDTH / 2.0f, lastY = SCR_HEIGHT / 2.0f;
 float fov = 45.0f;
 
 // timing
 float deltaTime = 0.0f; // Time between current frame and last frame
-float lastFrame = 0.0f; // Time of last frame
+double inputEpoch = 0.0; // input event times are relative to this
+
+// movement runs at a fixed tick rate; rendering interpolates the player
+// position between the last two ticks
+FixedTimestep timestep;
+Interpolated<glm::vec3> playerPosition;
+
+// F12 screenshots, read back asynchronously
+FrameCapture frameCapture;
+int screenshotCount = 0;
+
+// GPU time per render pass
+GpuTimer gpuTimer;
+
+// frame, phase and pass time histograms. F11 writes them to summaryPath;
+// at exit they are written only when --summary named the file
+PerfSummary perfSummary;
+std::string summaryPath = "summary.txt";
+
+// input of the current frame, live or replayed, and the key state it leaves;
+// keyDown belongs to whichever thread runs the simulation
+std::vector<InputEvent> frameInput;
+bool keyDown[GLFW_KEY_LAST + 1] = {false};
+
+// without the simulation thread: the events waiting for their tick, and how
+// many the ticks have applied
+TickInput tickInput;
+unsigned long inputApplied = 0;
 
 static GLFWwindow* windowInit()
 {
@@ -67,7 +122,13 @@ static GLFWwindow* windowInit()
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+#ifdef GLFW_RAW_MOUSE_MOTION
+    // unaccelerated motion straight from the device, where there is any
+    if (glfwRawMouseMotionSupported())
+        glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+#endif
     glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetKeyCallback(window, key_callback);
     glfwSetScrollCallback(window, scroll_callback);
 
     // glad: load all OpenGL function pointers
@@ -77,6 +138,7 @@ static GLFWwindow* windowInit()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return NULL;
     }
+    loadGLExtensions((GLADloadproc)glfwGetProcAddress);
     return window;
 }
 
@@ -87,40 +149,27 @@ static void clearScreen()
     glEnable(GL_DEPTH_TEST);
 }
 
-int main()
+// vertex arrays and buffers used by the render loop
+struct SceneBuffers
 {
-    GLFWwindow* window = windowInit();
-    if (window == NULL)
-        return -1;
-    // ------------------------------------
-    // load shader program
-    Shader floorShader("shaders/texture.vert", "shaders/texture.frag");
-    Shader lightingShader("shaders/light.vert", "shaders/light.frag");
-    Shader lightSourceShader("shaders/lightSource.vert",
-                             "shaders/lightSource.frag");
-
-    // set up texture
-    // ------------------------------------------------------------------
-    Texture texture1("media/container.jpg");
-    Texture texture2("media/awesomeface.png");
-    Texture texture3("media/container2.png");
-    Texture texture3_specular("media/container2_specular.png");
-    Texture texture3_specular_color("media/container2_specular_color.png");
-    Texture texture4_emission("media/matrix.jpg");
-    Texture texture_grass("media/grass.jpg");
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
     unsigned int VBO, VAO, EBO;
+    unsigned int lightingVAO, lightingVBO;
+    unsigned int lightCubeVAO;
+    unsigned int crowdVAO; // cube plus one instance vec4 on attribute 3
+};
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+// set up vertex data (and buffer(s)) and configure vertex attributes
+// ------------------------------------------------------------------
+static void setupBuffers(SceneBuffers& b)
+{
+    glGenVertexArrays(1, &b.VAO);
+    glGenBuffers(1, &b.VBO);
+    glGenBuffers(1, &b.EBO);
     // bind the Vertex Array Object first, then bind and set vertex buffer(s),
     // and then configure vertex attributes(s).
-    glBindVertexArray(VAO);
+    glBindVertexArray(b.VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, b.VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices,
                  GL_STATIC_DRAW);
 
@@ -154,13 +203,12 @@ int main()
     glBindVertexArray(0);
 
     // lighting object
-    unsigned int lightingVAO, lightingVBO;
-    glGenVertexArrays(1, &lightingVAO);
-    glBindVertexArray(lightingVAO);
+    glGenVertexArrays(1, &b.lightingVAO);
+    glBindVertexArray(b.lightingVAO);
     // we only need to bind to the VBO, the container's VBO's data already
     // contains the data.
-    glGenBuffers(1, &lightingVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, lightingVBO);
+    glGenBuffers(1, &b.lightingVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, b.lightingVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices,
                  GL_STATIC_DRAW);
     // set the vertex attribute
@@ -184,53 +232,656 @@ int main()
     // the same for the light object which is also a 3D cube)
 
     // the source of light
-    unsigned int lightCubeVAO;
-    glGenVertexArrays(1, &lightCubeVAO);
-    glBindVertexArray(lightCubeVAO);
+    glGenVertexArrays(1, &b.lightCubeVAO);
+    glBindVertexArray(b.lightCubeVAO);
 
     // we only need to bind to the VBO (to link it with glVertexAttribPointer),
     // no need to fill it; the VBO's data already contains all we need (it's
     // already bound, but we do it again for educational purposes)
-    glBindBuffer(GL_ARRAY_BUFFER, lightingVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, b.lightingVBO);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
                           (void*)0);
     glEnableVertexAttribArray(0);
 
+    glBindVertexArray(0);
+
+    // crowd: the cube again, the per-instance data is pointed at each frame
+    glGenVertexArrays(1, &b.crowdVAO);
+    glBindVertexArray(b.crowdVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, b.VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
+                          (void*)0);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
     glBindVertexArray(0);
     // uncomment this call to draw in wireframe polygons.
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+}
+
+// everything the render loop draws
+struct Scene
+{
+    Shader floorShader, lightingShader, lightSourceShader, crowdShader;
+    Texture texture1, texture2, texture3, texture3_specular,
+        texture3_specular_color, texture4_emission, texture_grass;
+    SceneBuffers buffers;
+    Map map;
+    StreamBuffer crowdStream; // visible crowd instances, rewritten per frame
+    size_t crowdSize = 0;
+    // Setup object and light source position
+    glm::vec3 objectPos = glm::vec3(15.0f, 10.0f, 22.0f);
+    glm::vec3 lightPos = glm::vec3(10.0f, 10.0f, 20.0f);
+};
+
+// command line: ./app [--headless] [--size WxH] [--frames N] [--capture FILE]
+//                    [--record FILE | --replay FILE] [--csv FILE]
+//                    [--bench SCENE|all] [--bench-out FILE] [--trace FILE]
+//                    [--gl-stats] [--gl-stats-out FILE] [--gl-check]
+//                    [--summary FILE] [--jobs N]
+//                    [--tick-hz HZ] [--max-ticks N] [--sim-ticks N]
+//                    [--sim-thread | --sync] [--npcs N]
+struct Options
+{
+    bool headless = false;
+    int width = SCR_WIDTH;
+    int height = SCR_HEIGHT;
+    int frames = 0; // 0 runs until the window is closed
+    std::string capturePath;
+    std::string recordPath;
+    std::string replayPath;
+    std::string csvPath;
+    std::string benchScene;
+    std::string benchOut; // JSON results, stdout if empty
+    std::string tracePath; // needs a PROFILE=1 build
+    bool glStats = false;
+    bool glCheck = false;   // redundant state and glGetError after each call
+    std::string glStatsOut; // per-frame counters as CSV
+    std::string summaryPath; // histograms for perfcompare, written at exit
+    int jobs = -1; // worker threads, -1 picks one per spare core
+    double tickHz = 60.0;
+    int maxTicks = 5; // per frame, the rest of a long stall is dropped
+    int simTicks = 0; // > 0: simulation only, no context, then exit
+    // the simulation gets its own thread for interactive runs; --sim-thread
+    // also uses it headless or with a replay, --sync never does
+    bool simThread = false;
+    bool sync = false;
+    int npcs = 0; // walkers in the crowd
+    // poll input again just before drawing and turn the view by what came in
+    bool lateLatch = false;
+};
+
+static bool parseArgs(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless")
+            options.headless = true;
+        else if (arg == "--size" && hasValue &&
+                 std::sscanf(argv[++i], "%dx%d", &options.width,
+                             &options.height) == 2)
+            continue;
+        else if (arg == "--frames" && hasValue)
+            options.frames = std::atoi(argv[++i]);
+        else if (arg == "--capture" && hasValue)
+            options.capturePath = argv[++i];
+        else if (arg == "--record" && hasValue)
+            options.recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue)
+            options.replayPath = argv[++i];
+        else if (arg == "--csv" && hasValue)
+            options.csvPath = argv[++i];
+        else if (arg == "--bench" && hasValue)
+            options.benchScene = argv[++i];
+        else if (arg == "--bench-out" && hasValue)
+            options.benchOut = argv[++i];
+        else if (arg == "--trace" && hasValue)
+            options.tracePath = argv[++i];
+        else if (arg == "--summary" && hasValue)
+            options.summaryPath = argv[++i];
+        else if (arg == "--jobs" && hasValue)
+            options.jobs = std::atoi(argv[++i]);
+        else if (arg == "--tick-hz" && hasValue)
+            options.tickHz = std::atof(argv[++i]);
+        else if (arg == "--max-ticks" && hasValue)
+            options.maxTicks = std::atoi(argv[++i]);
+        else if (arg == "--sim-ticks" && hasValue)
+            options.simTicks = std::atoi(argv[++i]);
+        else if (arg == "--sim-thread")
+            options.simThread = true;
+        else if (arg == "--sync")
+            options.sync = true;
+        else if (arg == "--npcs" && hasValue)
+            options.npcs = std::atoi(argv[++i]);
+        else if (arg == "--late-latch")
+            options.lateLatch = true;
+        else if (arg == "--gl-stats")
+            options.glStats = true;
+        else if (arg == "--gl-check")
+            options.glStats = options.glCheck = true;
+        else if (arg == "--gl-stats-out" && hasValue)
+        {
+            options.glStats = true;
+            options.glStatsOut = argv[++i];
+        }
+        else
+        {
+            std::cout << "usage: " << argv[0]
+                      << " [--headless] [--size WxH] [--frames N]"
+                         " [--capture out.png|out.raw]"
+                         " [--record in.bin | --replay in.bin] [--csv out.csv]"
+                         " [--bench low_pass|overview|spin|all]"
+                         " [--bench-out out.json] [--trace trace.json]"
+                         " [--gl-stats] [--gl-stats-out out.csv] [--gl-check]"
+                         " [--summary summary.txt] [--jobs N]"
+                         " [--tick-hz 60] [--max-ticks 5] [--sim-ticks N]"
+                         " [--sim-thread | --sync] [--npcs N] [--late-latch]"
+                      << std::endl;
+            return false;
+        }
+    }
+#ifndef FPV_PROFILE
+    if (!options.tracePath.empty())
+        std::cout << "ERROR::PROFILER::DISABLED: rebuild with make PROFILE=1"
+                  << std::endl;
+#endif
+    // headless runs are benchmarks and always end; a replay ends with the
+    // recording and a flythrough with its last scene
+    if (options.headless && options.frames <= 0 &&
+        options.replayPath.empty() && options.benchScene.empty())
+        options.frames = 300;
+    return true;
+}
+
+static double now()
+{
+    static const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+// timestamp of an input event, seconds since the render loop started
+static float inputTime() { return (float)(now() - inputEpoch); }
+
+// startup: CPU-only work (shader sources, image decode, terrain) runs on
+// worker threads while GL work is serialized onto this thread as soon as its
+// inputs are ready. `createContext` is the first GL stage.
+// ------------------------------------------------------------------
+static bool loadScene(Scene& scene, StartupGraph::StageFn createContext)
+{
+    StartupGraph startup;
+    int contextStage = startup.add("window + context", STAGE_GL, createContext);
 
-    texture1.active2D();
-    texture2.active2D();
-    texture3.active2D();
-    texture3_specular.active2D();
-    // texture3_specular_color.active2D();
-    texture4_emission.active2D();
-    texture_grass.active2D();
+    // load shader program
+    struct ShaderJob
+    {
+        const char* vertexPath;
+        const char* fragmentPath;
+        Shader* shader;
+        Shader::Source source;
+    } shaderJobs[] = {
+        {"shaders/texture.vert", "shaders/texture.frag", &scene.floorShader},
+        {"shaders/light.vert", "shaders/light.frag", &scene.lightingShader},
+        {"shaders/lightSource.vert", "shaders/lightSource.frag",
+         &scene.lightSourceShader},
+        {"shaders/crowd.vert", "shaders/crowd.frag", &scene.crowdShader},
+    };
+    std::vector<int> shaderStages;
+    for (ShaderJob& job : shaderJobs)
+    {
+        ShaderJob* j = &job;
+        int read = startup.add(std::string("read ") + j->vertexPath, STAGE_CPU,
+                               [j]() {
+                                   j->source = Shader::readSource(
+                                       j->vertexPath, j->fragmentPath);
+                                   return true;
+                               });
+        // all programs are submitted up front; each one is checked once the
+        // driver reports it finished compiling
+        int submit = startup.add(std::string("submit ") + j->vertexPath,
+                                 STAGE_GL, {contextStage, read}, [j]() {
+                                     j->shader->submit(j->source);
+                                     return true;
+                                 });
+        int link = startup.add(std::string("link ") + j->vertexPath, STAGE_GL,
+                               {submit}, [j]() {
+                                   j->shader->finish();
+                                   return true;
+                               });
+        startup.setReady(link, [j]() { return j->shader->isReady(); });
+        shaderStages.push_back(link);
+    }
+
+    // set up texture
+    // ------------------------------------------------------------------
+    struct TextureJob
+    {
+        const char* path;
+        Texture* texture;
+        Texture::Image image;
+    } textureJobs[] = {
+        {"media/container.jpg", &scene.texture1},
+        {"media/awesomeface.png", &scene.texture2},
+        {"media/container2.png", &scene.texture3},
+        {"media/container2_specular.png", &scene.texture3_specular},
+        {"media/container2_specular_color.png",
+         &scene.texture3_specular_color},
+        {"media/matrix.jpg", &scene.texture4_emission},
+        {"media/grass.jpg", &scene.texture_grass},
+    };
+    std::vector<int> textureStages;
+    for (TextureJob& job : textureJobs)
+    {
+        TextureJob* j = &job;
+        int decode = startup.add(std::string("decode ") + j->path, STAGE_CPU,
+                                 [j]() {
+                                     j->image = Texture::decode(j->path);
+                                     return true;
+                                 });
+        int upload = startup.add(std::string("upload ") + j->path, STAGE_GL,
+                                 {contextStage, decode}, [j]() {
+                                     j->texture->upload(j->image);
+                                     return true;
+                                 });
+        textureStages.push_back(upload);
+    }
+
+    startup.add("vertex buffers", STAGE_GL, {contextStage}, [&]() {
+        setupBuffers(scene.buffers);
+        if (scene.crowdSize)
+            scene.crowdStream.init(GL_ARRAY_BUFFER,
+                                   scene.crowdSize * sizeof(glm::vec4));
+        return true;
+    });
+
+    int terrainStage = startup.add("terrain noise", STAGE_CPU, [&]() {
+        scene.map.generate(MAP_WIDTH, MAP_HEIGHT);
+        return true;
+    });
+    startup.add("floor transforms", STAGE_CPU, {terrainStage}, [&]() {
+        scene.map.buildFloorTransforms();
+        return true;
+    });
+
+    std::vector<int> materialDeps = textureStages;
+    materialDeps.push_back(shaderStages[1]);
+    startup.add("bind materials", STAGE_GL, materialDeps, [&]() {
+        scene.texture1.active2D();
+        scene.texture2.active2D();
+        scene.texture3.active2D();
+        scene.texture3_specular.active2D();
+        // texture3_specular_color.active2D();
+        scene.texture4_emission.active2D();
+        scene.texture_grass.active2D();
+        Shader& lightingShader = scene.lightingShader;
+        lightingShader.use();
+        lightingShader.setInt("material.diffuse", scene.texture3.ID);
+        lightingShader.setInt("material.specular", scene.texture3_specular.ID);
+        lightingShader.setInt("material.emission", scene.texture4_emission.ID);
+        return true;
+    });
+
+    if (!startup.run())
+        return false;
+    startup.printReport(std::cout);
+    return true;
+}
+
+
+// one fixed simulation step: walk along the held movement keys, fall and
+// collide with the terrain
+static void simulateTick(const Map& map, float dt)
+{
+    playerPosition.beginTick();
+    glm::vec2 wish(0.0f);
+    if (keyDown[GLFW_KEY_W])
+        wish.y += 1.0f;
+    if (keyDown[GLFW_KEY_S])
+        wish.y -= 1.0f;
+    if (keyDown[GLFW_KEY_A])
+        wish.x -= 1.0f;
+    if (keyDown[GLFW_KEY_D])
+        wish.x += 1.0f;
+    player.Move(wish, dt, map);
+    crowd.update(map, dt);
+    playerPosition.current = player.camera.Position;
+}
+
+// the ticks a frame of `deltaTime` (live or replayed) made due, each
+// starting with the input stamped up to its end; returns how many ran
+static int runTicks(const Map& map, float deltaTime)
+{
+    return tickInput.frame(
+        deltaTime, timestep, [&map](const std::vector<InputEvent>& events) {
+            applyInput(events);
+            inputApplied += events.size();
+            simulateTick(map, timestep.step());
+        });
+}
+
+// the player camera as the render thread sees it at `time`: the position
+// interpolated between the snapshot's last two ticks, the same way the
+// single-threaded loop does, and the look as of the last tick
+static Camera snapshotCamera(const RenderSnapshot& s, double time, float step)
+{
+    float alpha = glm::clamp((float)((time - s.time) / step), 0.0f, 1.0f);
+    Camera eye(glm::mix(s.previousPosition, s.position, alpha),
+               glm::vec3(0.0f, 1.0f, 0.0f), s.look.x, s.look.y);
+    eye.Zoom = s.zoom;
+    return eye;
+}
+
+// --sim-ticks: the simulation alone, ticks back to back without a context or
+// rendering. Input comes from --replay when given; otherwise the player walks
+// a circle around the middle of the map.
+static int runSimulation(const Options& options)
+{
+    Map map;
+    map.generate(MAP_WIDTH, MAP_HEIGHT);
+    if (options.npcs > 0)
+        crowd.populate(map, options.npcs);
+    InputReplayer replay;
+    if (!options.replayPath.empty() && !replay.open(options.replayPath.c_str()))
+        return -1;
+    if (!replay.isOpen())
+    {
+        player.camera.Position =
+            glm::vec3(MAP_WIDTH / 2.0f, 10.0f, MAP_HEIGHT / 2.0f);
+        keyDown[GLFW_KEY_W] = true;
+    }
+    playerPosition.reset(player.camera.Position);
+
+    double start = now();
+    unsigned long ticks = 0;
+    while (ticks < (unsigned long)options.simTicks)
+    {
+        if (!replay.isOpen())
+        {
+            player.camera.ProcessMouseMovement(10.0f, 0.0f);
+            simulateTick(map, timestep.step());
+            ++ticks;
+            continue;
+        }
+        float dt = 0.0f;
+        if (!replay.readFrame(dt, frameInput))
+            break;
+        for (const InputEvent& event : frameInput)
+            tickInput.push(event);
+        ticks += runTicks(map, dt);
+    }
+    double ms = (now() - start) * 1000.0;
+    glm::vec3 p = player.camera.Position;
+    std::printf("simulation: %lu ticks in %.3f ms, %.3f us/tick, "
+                "player at %.3f %.3f %.3f, %zu npcs\n",
+                ticks, ms, ticks ? ms * 1000.0 / ticks : 0.0, p.x, p.y, p.z,
+                crowd.positions.size());
+    return 0;
+}
+
+// draws one frame of the scene into the bound framebuffer, seen from `eye`
+static DrawCounts drawScene(Scene& scene, const Camera& eye,
+                            const glm::mat4& view, const glm::mat4& projection,
+                            const std::vector<glm::vec4>& crowdInstances)
+{
+    DrawCounts counts;
+    Shader& floorShader = scene.floorShader;
+    Shader& lightingShader = scene.lightingShader;
+    Shader& lightSourceShader = scene.lightSourceShader;
+
+    // seeing as we only have a single VAO
+    // there's no need to bind it every time, but we'll do
+    // so to keep things a bit more organized
+    // glDrawArrays(GL_TRIANGLES, 0, 15);
+    glBindVertexArray(scene.buffers.VAO);
+
+    // floor shader
+    unsigned int pass = gpuTimer.begin("floor");
+    floorShader.use();
+    floorShader.setInt("texture1",
+                       scene.texture_grass.ID); // or with shader class
+    floorShader.setInt("texture2", scene.texture2.ID);
+    floorShader.setMat4("view", view);
+    floorShader.setMat4("projection", projection);
+    scene.map.cullFloor(projection * view);
+    counts.add(scene.map.createFloor(floorShader, true), 12);
+    gpuTimer.end(pass);
+
+    // lightSource shader
+    pass = gpuTimer.begin("light cube");
+    glm::mat4 model = glm::mat4(1.0f);
+    lightSourceShader.use();
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, scene.lightPos);
+
+    lightSourceShader.setMat4("projection", projection);
+    lightSourceShader.setMat4("view", view);
+    lightSourceShader.setMat4("model", model);
+
+    glBindVertexArray(scene.buffers.lightCubeVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    counts.add(1, 12);
+    gpuTimer.end(pass);
+
+    // lighting shader(the object which is spoted by light source)
+    pass = gpuTimer.begin("lit object");
     lightingShader.use();
-    lightingShader.setInt("material.diffuse", texture3.ID);
-    lightingShader.setInt("material.specular", texture3_specular.ID);
-    lightingShader.setInt("material.emission", texture4_emission.ID);
+    glm::vec3 lightColor(1.0f);
+    // lightColor.x = sin(glfwGetTime() * 2.0f);
+    // lightColor.y = sin(glfwGetTime() * 0.7f);
+    // lightColor.z = sin(glfwGetTime() * 1.3f);
+
+    glm::vec3 diffuseColor = lightColor * glm::vec3(0.5f);
+    glm::vec3 ambientColor = diffuseColor * glm::vec3(0.2f);
+
+    lightingShader.setVec3("light.ambient", ambientColor);
+    lightingShader.setVec3("light.diffuse", diffuseColor);
+    lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+
+    lightingShader.setFloat("light.constant", 1.0f);
+    lightingShader.setFloat("light.linear", 0.09f);
+    lightingShader.setFloat("light.quadratic", 0.032f);
+
+    lightingShader.setVec3("light.position", eye.Position);
+    lightingShader.setVec3("light.direction", eye.Front);
+    lightingShader.setFloat("light.cutOff", glm::cos(glm::radians(12.5f)));
+    lightingShader.setFloat("light.outerCutOff",
+                            glm::cos(glm::radians(17.5f)));
+
+    // lightingShader.setVec3("material.ambient", ambientColor);
+    lightingShader.setFloat("material.shininess", 32.0f);
+
+    lightingShader.setMat4("projection", projection);
+    lightingShader.setMat4("view", view);
+
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, scene.objectPos);
+    // model = glm::scale(model, glm::vec3(2.0f)); // a smaller cube
+    lightingShader.setMat4("model", model);
+    lightingShader.setVec3("viewPos", eye.Position);
+    lightingShader.setVec3("lightPos", scene.lightPos);
+
+    glBindVertexArray(scene.buffers.lightingVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    counts.add(1, 12);
+    gpuTimer.end(pass);
+
+    // the crowd, one instanced draw
+    if (!crowdInstances.empty())
+    {
+        pass = gpuTimer.begin("crowd");
+        Shader& crowdShader = scene.crowdShader;
+        Collider size;
+        crowdShader.use();
+        crowdShader.setMat4("view", view);
+        crowdShader.setMat4("projection", projection);
+        crowdShader.setVec3("size", 2.0f * size.halfWidth, size.height,
+                            2.0f * size.halfWidth);
+        unsigned int drawn =
+            drawCrowd(crowdInstances, projection * view, scene.crowdStream,
+                      scene.buffers.crowdVAO, size);
+        if (drawn)
+            counts.add(1, 12 * drawn);
+        gpuTimer.end(pass);
+    }
+    return counts;
+}
 
-    Map map(MAP_WIDTH, MAP_HEIGHT);
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseArgs(argc, argv, options))
+        return -1;
+    PROFILE_THREAD_NAME("main");
+    timestep.configure(options.tickHz, options.maxTicks);
+    if (options.simTicks > 0)
+        return runSimulation(options);
+    jobSystem().start(options.jobs >= 0 ? (unsigned int)options.jobs
+                                        : JobSystem::defaultWorkerCount());
+
+    GLFWwindow* window = NULL;
+    HeadlessContext headless;
+    Scene scene;
+    scene.crowdSize = options.npcs > 0 ? options.npcs : 0;
+    bool loaded = loadScene(scene, [&]() {
+        if (options.headless)
+            return headless.init(options.width, options.height);
+        window = windowInit();
+        return window != NULL;
+    });
+    if (!loaded)
+        return -1;
+
+    int renderWidth = options.width, renderHeight = options.height;
+    if (window)
+        glfwGetFramebufferSize(window, &renderWidth, &renderHeight);
+    frameCapture.init(renderWidth, renderHeight);
+    // counts from here on, startup uploads are not part of any frame
+    if (options.glStats)
+    {
+        glStats().install(options.glCheck);
+        if (!options.glStatsOut.empty())
+            glStats().dumpTo(options.glStatsOut.c_str());
+    }
+    gpuTimer.init();
+    gpuTimer.onResult = [](const char* pass, double ms) {
+        perfSummary.record(std::string("gpu ") + pass, ms);
+    };
+    if (!options.summaryPath.empty())
+        summaryPath = options.summaryPath;
+    bool captureLastFrame = false;
+    if (options.capturePath.size() > 4 &&
+        options.capturePath.compare(options.capturePath.size() - 4, 4,
+                                    ".png") == 0)
+        captureLastFrame = true;
+    else if (!options.capturePath.empty())
+        frameCapture.startSequence(options.capturePath);
 
     // Setup view and projection space
+    Camera eye = player.camera; // player camera as rendered this frame
     glm::mat4 view;
     glm::mat4 projection =
         glm::perspective(glm::radians(player.camera.Zoom),
-                         (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+                         (float)renderWidth / (float)renderHeight, 0.1f,
+                         100.0f);
+
+    // deterministic input: a replay feeds recorded events back with the
+    // recorded frame deltas, whatever the real frame time is
+    InputRecorder recorder;
+    InputReplayer replay;
+    if (!options.recordPath.empty() &&
+        !recorder.open(options.recordPath.c_str()))
+        return -1;
+    if (!options.replayPath.empty() && !replay.open(options.replayPath.c_str()))
+        return -1;
+    if (replay.isOpen() && options.frames <= 0)
+        options.frames = (int)replay.frameCount();
+    // scripted flythrough: the camera follows the scene paths instead of the
+    // player
+    FlythroughBenchmark bench;
+    if (!options.benchScene.empty() &&
+        !bench.select(benchmarkScenes(MAP_WIDTH, MAP_HEIGHT),
+                      options.benchScene))
+        return -1;
+    std::ofstream csv;
+    if (!options.csvPath.empty())
+    {
+        csv.open(options.csvPath.c_str());
+        csv << "frame,sim_dt_ms,cpu_ms,frame_ms,ticks" << std::endl;
+    }
 
-    // Setup object and light source position
-    glm::vec3 objectPos(15.0f, 10.0f, 22.0f);
-    glm::vec3 lightPos(10.0f, 10.0f, 20.0f);
+    playerPosition.reset(player.camera.Position);
+    if (scene.crowdSize)
+        crowd.populate(scene.map, scene.crowdSize);
+    std::vector<glm::vec4> crowdInstances; // as of the last tick
+    crowd.gatherInstances(crowdInstances);
+    FrameTimings timings;
+    int frame = 0;
+    double lastFrameTime = now();
+    inputEpoch = lastFrameTime;
+
+    // With its own thread the simulation ticks on the wall clock, gets the
+    // events through a queue and hands back a snapshot; from here on only it
+    // touches `player`. Replays, recordings and flythroughs stay on this
+    // thread so they remain frame-for-frame reproducible.
+    SimulationThread simulation;
+    bool threaded = !options.sync && options.recordPath.empty() &&
+                    options.benchScene.empty() &&
+                    (options.simThread || (window && !replay.isOpen()));
+    if (threaded)
+        simulation.start(
+            timestep, applyInput,
+            [&scene](float dt) { simulateTick(scene.map, dt); },
+            [](RenderSnapshot& s) {
+                s.previousPosition = playerPosition.previous;
+                s.position = playerPosition.current;
+                s.look = glm::vec2(player.camera.Yaw, player.camera.Pitch);
+                s.zoom = player.camera.Zoom;
+                crowd.gatherInstances(s.crowd);
+            },
+            now, inputEpoch);
+    unsigned long seenTick = 0;
+    float reportedInput = -1.0f;
+    // input as the simulation runs it, with mouse look on top that it has
+    // not applied yet
+    LookLatch lookLatch;
+    // newest mouse move drawn, and the oldest one this frame draws first
+    float lookDrawn = -1.0f, lookFirstDrawn = -1.0f;
+    auto noteLook = [&](const InputEvent& event) {
+        if (event.type != INPUT_MOUSE_MOVE || event.time <= lookDrawn)
+            return;
+        if (lookFirstDrawn < 0.0f)
+            lookFirstDrawn = event.time;
+        lookDrawn = event.time;
+    };
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    while ((window ? !glfwWindowShouldClose(window)
+                   : options.frames <= 0 || frame < options.frames) &&
+           (options.benchScene.empty() || bench.active()))
     {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        PROFILE_SCOPE("frame");
+        gpuTimer.beginFrame();
+        double currentFrame = now();
+        double frameMs = (currentFrame - lastFrameTime) * 1000.0;
+        deltaTime = currentFrame - lastFrameTime;
+        if (frame > 0)
+        {
+            timings.add(frameMs);
+            perfSummary.record("frame", frameMs);
+        }
+        lastFrameTime = currentFrame;
+        // CPU time of each phase since the previous lap
+        double lapStart = currentFrame;
+        auto lap = [&](const char* phase) {
+            double t = now();
+            perfSummary.record(phase, (t - lapStart) * 1000.0);
+            lapStart = t;
+        };
 
         // std::cout << player.camera.Position.x << "," <<
         // player.camera.Position.y
@@ -238,93 +889,165 @@ int main()
 
         //  input
         //  -----
-        processInput(window);
+        {
+            PROFILE_SCOPE("input");
+            if (window)
+                processInput(window);
+            if (replay.isOpen())
+            {
+                // live events are dropped so the run stays reproducible
+                if (!replay.readFrame(deltaTime, frameInput))
+                    break;
+            }
+            for (InputEvent event : frameInput)
+            {
+                lookLatch.sent(event);
+                if (!replay.isOpen())
+                    noteLook(event);
+                if (!simulation.running())
+                    tickInput.push(event);
+                else
+                {
+                    // a replayed event counts as arriving now
+                    if (replay.isOpen())
+                        event.time = inputTime();
+                    simulation.sendInput(event);
+                }
+            }
+            recorder.writeFrame(deltaTime, frameInput);
+            frameInput.clear();
+        }
+        lap("cpu input");
+
+        // update
+        // ------
+        int ticks = 0;
+        const RenderSnapshot* snapshot = NULL;
+        if (simulation.running())
+        {
+            // never waits: until the first tick there is nothing new to show
+            PROFILE_SCOPE("update");
+            snapshot = simulation.latest();
+            if (snapshot)
+            {
+                ticks = (int)(snapshot->tick - seenTick);
+                seenTick = snapshot->tick;
+                eye = snapshotCamera(*snapshot, now(), timestep.step());
+                lookLatch.applied(snapshot->inputApplied);
+            }
+            lookLatch.forEachPending(
+                [&eye](float x, float y) { eye.ProcessMouseMovement(x, y); });
+            view = eye.GetViewMatrix();
+            projection = glm::perspective(
+                glm::radians(eye.Zoom),
+                (float)renderWidth / (float)renderHeight, 0.1f, 100.0f);
+        }
+        else
+        {
+            PROFILE_SCOPE("update");
+            // deltaTime is the replayed one on a replay, so the same
+            // events fall into the same ticks however fast this runs
+            ticks = runTicks(scene.map, deltaTime);
+            lookLatch.applied(inputApplied);
+            if (ticks > 0 && crowd.meshes.size() > 0)
+                crowd.gatherInstances(crowdInstances);
+            // the view follows the player between ticks; mouse look the
+            // ticks have not taken yet is added on top, so it never lags
+            if (bench.active())
+            {
+                bench.apply(player.camera);
+                playerPosition.reset(player.camera.Position);
+            }
+            eye = player.camera;
+            eye.Position = playerPosition.at(timestep.alpha());
+            lookLatch.forEachPending(
+                [&eye](float x, float y) { eye.ProcessMouseMovement(x, y); });
+
+            // view/projection transformations
+            view = eye.GetViewMatrix();
+            projection = glm::perspective(
+                glm::radians(player.camera.Zoom),
+                (float)renderWidth / (float)renderHeight, 0.1f, 100.0f);
+        }
+        lap("cpu update");
+
+        // late latching: whatever mouse motion came in while this frame was
+        // being updated still turns its view. The events stay queued in
+        // frameInput and reach the simulation with the next frame.
+        if (options.lateLatch && window && !replay.isOpen() &&
+            !bench.active())
+        {
+            PROFILE_SCOPE("late latch");
+            size_t before = frameInput.size();
+            glfwPollEvents();
+            for (size_t i = before; i < frameInput.size(); ++i)
+                if (frameInput[i].type == INPUT_MOUSE_MOVE)
+                {
+                    eye.ProcessMouseMovement(frameInput[i].x, frameInput[i].y);
+                    noteLook(frameInput[i]);
+                }
+            view = eye.GetViewMatrix();
+        }
 
         // render
         // ------
-        clearScreen();
-
-        // seeing as we only have a single VAO
-        // there's no need to bind it every time, but we'll do
-        // so to keep things a bit more organized
-        // glDrawArrays(GL_TRIANGLES, 0, 15);
-
-        player.Update_yPos(deltaTime, map.heightMap);
-        glBindVertexArray(VAO);
-
-        // view/projection transformations
-        view = player.camera.GetViewMatrix();
-        projection = glm::perspective(glm::radians(player.camera.Zoom),
-                                      (float)SCR_WIDTH / (float)SCR_HEIGHT,
-                                      0.1f, 100.0f);
-
-        // floor shader
-        floorShader.use();
-        floorShader.setInt("texture1",
-                           texture_grass.ID); // or with shader class
-        floorShader.setInt("texture2", texture2.ID);
-        floorShader.setMat4("view", view);
-        floorShader.setMat4("projection", projection);
-        map.createFloor(floorShader);
-
-        // lightSource shader
-        glm::mat4 model = glm::mat4(1.0f);
-        lightSourceShader.use();
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPos);
-
-        lightSourceShader.setMat4("projection", projection);
-        lightSourceShader.setMat4("view", view);
-        lightSourceShader.setMat4("model", model);
-
-        glBindVertexArray(lightCubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // lighting shader(the object which is spoted by light source)
-        lightingShader.use();
-        glm::vec3 lightColor(1.0f);
-        // lightColor.x = sin(glfwGetTime() * 2.0f);
-        // lightColor.y = sin(glfwGetTime() * 0.7f);
-        // lightColor.z = sin(glfwGetTime() * 1.3f);
-
-        glm::vec3 diffuseColor = lightColor * glm::vec3(0.5f);
-        glm::vec3 ambientColor = diffuseColor * glm::vec3(0.2f);
-
-        lightingShader.setVec3("light.ambient", ambientColor);
-        lightingShader.setVec3("light.diffuse", diffuseColor);
-        lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-
-        lightingShader.setFloat("light.constant", 1.0f);
-        lightingShader.setFloat("light.linear", 0.09f);
-        lightingShader.setFloat("light.quadratic", 0.032f);
-
-        lightingShader.setVec3("light.position", player.camera.Position);
-        lightingShader.setVec3("light.direction", player.camera.Front);
-        lightingShader.setFloat("light.cutOff", glm::cos(glm::radians(12.5f)));
-        lightingShader.setFloat("light.outerCutOff",
-                                glm::cos(glm::radians(17.5f)));
-
-        // lightingShader.setVec3("material.ambient", ambientColor);
-        lightingShader.setFloat("material.shininess", 32.0f);
-
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, objectPos);
-        // model = glm::scale(model, glm::vec3(2.0f)); // a smaller cube
-        lightingShader.setMat4("model", model);
-        lightingShader.setVec3("viewPos", player.camera.Position);
-        lightingShader.setVec3("lightPos", lightPos);
-
-        glBindVertexArray(lightingVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // glfw: swap buffers and poll IO events (keys
-        // pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        DrawCounts counts;
+        {
+            PROFILE_SCOPE("draw");
+            clearScreen();
+            counts = drawScene(scene, eye, view, projection,
+                               snapshot ? snapshot->crowd : crowdInstances);
+        }
+        lap("cpu draw");
+        bench.endFrame(now(), counts);
+
+        if (csv.is_open())
+            csv << frame << ',' << deltaTime * 1000.0 << ','
+                << (now() - currentFrame) * 1000.0 << ','
+                << (frame > 0 ? frameMs : 0.0) << ',' << ticks << '\n';
+        ++frame;
+        if (captureLastFrame && frame == options.frames)
+            frameCapture.requestScreenshot(options.capturePath);
+        PROFILE_SCOPE("present");
+        if (!window)
+        {
+            frameCapture.capture(headless.framebuffer);
+            headless.present();
+        }
+        else
+        {
+            // glfw: swap buffers and poll IO events (keys
+            // pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            frameCapture.capture();
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            if (options.frames > 0 && frame >= options.frames)
+                glfwSetWindowShouldClose(window, true);
+        }
+        if (snapshot)
+        {
+            // each input is reported once, by the first frame showing it
+            if (snapshot->inputTime >= 0.0f &&
+                snapshot->inputTime != reportedInput)
+            {
+                perfSummary.record("latency input to present",
+                                   (inputTime() - snapshot->inputTime) *
+                                       1000.0);
+                reportedInput = snapshot->inputTime;
+            }
+            simulation.markPresented(snapshot->tick);
+        }
+        if (lookFirstDrawn >= 0.0f)
+        {
+            perfSummary.record("latency look to present",
+                               (inputTime() - lookFirstDrawn) * 1000.0);
+            lookFirstDrawn = -1.0f;
+        }
+        if (glStats().installed())
+            glStats().endFrame();
+        FrameArenas::instance().endFrame();
+        lap("cpu present");
     }
     // 步驟 1：將 A 物體平移到相對於 B 物體的位置（即將 B
     // 物體作為臨時原點）
@@ -339,21 +1062,70 @@ int main()
     // model = glm::translate(model, lightPos - objectPos); //
     // 初始位置相對於 B 的偏移
 
+    simulation.stop();
+    // the last frames' GPU times are still in flight
+    gpuTimer.shutdown();
+    timings.print(std::cout, options.headless ? "headless" : "frame time");
+    gpuTimer.print(std::cout);
+    timestep.print(std::cout);
+    for (const char* what : {"input", "look"})
+    {
+        std::string zone = std::string("latency ") + what + " to present";
+        if (!perfSummary.zones.count(zone))
+            continue;
+        const Histogram& latency = perfSummary.zones[zone];
+        std::printf("%s to present%s: %llu inputs, p50 %.2f ms, "
+                    "p99 %.2f ms\n",
+                    what, options.lateLatch ? " (late latched)" : "",
+                    (unsigned long long)latency.count(),
+                    latency.percentile(50), latency.percentile(99));
+    }
+    glStats().print(std::cout);
+    scene.crowdStream.print(std::cout, "crowd stream");
+    FrameArenas::instance().print(std::cout);
+    jobSystem().print(std::cout);
+    if (!options.summaryPath.empty())
+        perfSummary.write(summaryPath.c_str());
+    glStats().closeDump();
+    recorder.close();
+    if (!options.tracePath.empty())
+        PROFILE_WRITE_TRACE(options.tracePath.c_str());
+    if (!options.benchScene.empty())
+    {
+        std::string renderer = (const char*)glGetString(GL_RENDERER);
+        if (options.benchOut.empty())
+        {
+            bench.writeJson(std::cout, renderer, renderWidth, renderHeight);
+        }
+        else
+        {
+            std::ofstream out(options.benchOut.c_str());
+            bench.writeJson(out, renderer, renderWidth, renderHeight);
+            std::cout << "bench: wrote " << options.benchOut << std::endl;
+        }
+    }
+
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteVertexArrays(1, &lightingVAO);
-    glDeleteVertexArrays(1, &lightCubeVAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    glDeleteVertexArrays(1, &scene.buffers.VAO);
+    glDeleteVertexArrays(1, &scene.buffers.lightingVAO);
+    glDeleteVertexArrays(1, &scene.buffers.lightCubeVAO);
+    glDeleteVertexArrays(1, &scene.buffers.crowdVAO);
+    scene.crowdStream.destroy();
+    glDeleteBuffers(1, &scene.buffers.VBO);
+    glDeleteBuffers(1, &scene.buffers.EBO);
     // glDeleteProgram(shaderProgram_orange);
+    frameCapture.shutdown();
+    jobSystem().stop();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
-    glfwTerminate();
+    if (window)
+        glfwTerminate();
     return 0;
 }
 
+
 // process all input: query GLFW whether relevant keys are pressed/released this
 // frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
@@ -362,14 +1134,22 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        player.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        player.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        player.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        player.ProcessKeyboard(RIGHT, deltaTime);
+    // keys for the simulation come in through key_callback
+
+    // screenshot on the F12 press, not while it is held
+    static bool screenshotKeyDown = false;
+    bool screenshotKey = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+    if (screenshotKey && !screenshotKeyDown)
+        frameCapture.requestScreenshot(
+            "screenshot_" + std::to_string(++screenshotCount) + ".png");
+    screenshotKeyDown = screenshotKey;
+
+    // F11 writes the histograms collected so far
+    static bool summaryKeyDown = false;
+    bool summaryKey = glfwGetKey(window, GLFW_KEY_F11) == GLFW_PRESS;
+    if (summaryKey && !summaryKeyDown)
+        perfSummary.write(summaryPath.c_str());
+    summaryKeyDown = summaryKey;
 }
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
@@ -390,11 +1170,45 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
-    player.camera.ProcessMouseMovement(xoffset, yoffset);
+    frameInput.push_back(makeInputEvent(INPUT_MOUSE_MOVE, inputTime(), 0, false,
+                                        xoffset, yoffset));
+}
+// every press and release, stamped when GLFW delivers it; repeats change
+// nothing the simulation keeps
+void key_callback(GLFWwindow* window, int key, int scancode, int action,
+                  int mods)
+{
+    if (action == GLFW_REPEAT || key < 0 || key > GLFW_KEY_LAST)
+        return;
+    frameInput.push_back(
+        makeInputEvent(INPUT_KEY, inputTime(), key, action == GLFW_PRESS));
 }
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    player.camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    frameInput.push_back(makeInputEvent(INPUT_SCROLL, inputTime(), 0, false,
+                                        static_cast<float>(xoffset),
+                                        static_cast<float>(yoffset)));
+}
+// key state, mouse look and zoom; movement itself happens in simulateTick
+// ---------------------------------------------------------------------------------------------
+void applyInput(const std::vector<InputEvent>& events)
+{
+    for (const InputEvent& event : events)
+    {
+        switch (event.type)
+        {
+        case INPUT_KEY:
+            if (event.key >= 0 && event.key <= GLFW_KEY_LAST)
+                keyDown[event.key] = event.pressed != 0;
+            break;
+        case INPUT_MOUSE_MOVE:
+            player.camera.ProcessMouseMovement(event.x, event.y);
+            break;
+        case INPUT_SCROLL:
+            player.camera.ProcessMouseScroll(event.y);
+            break;
+        }
+    }
 }
 // glfw: whenever the window size changed (by OS or user resize) this callback
 // function executes
@@ -405,4 +1219,6 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // and height will be significantly larger than specified on retina
     // displays.
     glViewport(0, 0, width, height);
+    // reading back at the old size would cut off or overrun the frame
+    frameCapture.resize(width, height);
 }
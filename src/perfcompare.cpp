@@ -0,0 +1,99 @@
+// Compares two perf summaries written with `./app --summary FILE` and flags
+// zones that got significantly slower.
+//
+//   ./perfcompare baseline.txt candidate.txt [--alpha 0.001]
+//                 [--min-change 10] [--min-delta 0.1]
+//
+// A zone regresses when the Mann-Whitney test rejects "same distribution" at
+// `alpha` and its median grew by at least `min-change` percent and
+// `min-delta` ms. Frame times are not independent samples and two runs of the
+// same build differ by a few percent, hence the small alpha and the change
+// thresholds. Exits with 1 if any zone regressed, which makes it usable as a
+// gate in scripts.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "histogram.hpp"
+
+int main(int argc, char** argv)
+{
+    double alpha = 0.001;
+    double minChange = 10.0;
+    double minDelta = 0.1;
+    const char* paths[2] = {NULL, NULL};
+    int pathCount = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--alpha") == 0 && i + 1 < argc)
+            alpha = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--min-change") == 0 && i + 1 < argc)
+            minChange = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--min-delta") == 0 && i + 1 < argc)
+            minDelta = std::atof(argv[++i]);
+        else if (pathCount < 2)
+            paths[pathCount++] = argv[i];
+        else
+            pathCount = 3;
+    }
+    if (pathCount != 2)
+    {
+        std::cout << "usage: " << argv[0]
+                  << " baseline.txt candidate.txt [--alpha 0.001]"
+                     " [--min-change 10] [--min-delta 0.1]"
+                  << std::endl;
+        return 2;
+    }
+
+    PerfSummary base, candidate;
+    if (!base.read(paths[0]) || !candidate.read(paths[1]))
+        return 2;
+
+    std::printf("%-24s %10s %10s %8s %10s  %s\n", "zone", "base p50",
+                "cand p50", "change", "p", "verdict");
+    int regressions = 0;
+    for (std::map<std::string, Histogram>::const_iterator it =
+             base.zones.begin();
+         it != base.zones.end(); ++it)
+    {
+        std::map<std::string, Histogram>::const_iterator other =
+            candidate.zones.find(it->first);
+        if (other == candidate.zones.end())
+        {
+            std::printf("%-24s %10.3f %10s %8s %10s  missing\n",
+                        it->first.c_str(), it->second.percentile(50), "-",
+                        "-", "-");
+            continue;
+        }
+        Comparison c = compareHistograms(it->second, other->second);
+        double delta = c.candidateMedian - c.baseMedian;
+        bool significant = c.p < alpha && std::fabs(delta) >= minDelta &&
+                           std::fabs(c.change) * 100.0 >= minChange;
+        const char* verdict = "same";
+        if (significant && delta > 0 && c.z > 0)
+        {
+            verdict = "REGRESSION";
+            ++regressions;
+        }
+        else if (significant && delta < 0 && c.z < 0)
+            verdict = "improved";
+        std::printf("%-24s %10.3f %10.3f %+7.1f%% %10.2g  %s\n",
+                    it->first.c_str(), c.baseMedian, c.candidateMedian,
+                    c.change * 100.0, c.p, verdict);
+    }
+    for (std::map<std::string, Histogram>::const_iterator it =
+             candidate.zones.begin();
+         it != candidate.zones.end(); ++it)
+        if (!base.zones.count(it->first))
+            std::printf("%-24s %10s %10.3f %8s %10s  new\n", it->first.c_str(),
+                        "-", it->second.percentile(50), "-", "-");
+
+    if (regressions)
+        std::printf("%d zone(s) regressed\n", regressions);
+    return regressions ? 1 : 0;
+}